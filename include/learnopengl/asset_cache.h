@@ -0,0 +1,119 @@
+#ifndef ASSET_CACHE_H
+#define ASSET_CACHE_H
+
+#include <learnopengl/hash.h>
+
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <fcntl.h>
+#include <unistd.h>
+
+#include <cstdio>
+#include <fstream>
+#include <string>
+
+// read-only memory mapping of a whole file. Move-only; the mapping is released in the destructor.
+class MappedFile
+{
+public:
+    MappedFile() : data(nullptr), size(0) {}
+
+    explicit MappedFile(const std::string &path) : data(nullptr), size(0)
+    {
+        int fd = open(path.c_str(), O_RDONLY);
+        if (fd < 0)
+            return;
+        struct stat info;
+        if (fstat(fd, &info) == 0 && info.st_size > 0)
+        {
+            void *mapping = mmap(nullptr, info.st_size, PROT_READ, MAP_PRIVATE, fd, 0);
+            if (mapping != MAP_FAILED)
+            {
+                data = (const unsigned char *)mapping;
+                size = info.st_size;
+            }
+        }
+        // the mapping stays valid after the descriptor is closed
+        close(fd);
+    }
+
+    MappedFile(MappedFile &&other) : data(other.data), size(other.size)
+    {
+        other.data = nullptr;
+        other.size = 0;
+    }
+
+    MappedFile &operator=(MappedFile &&other)
+    {
+        if (this != &other)
+        {
+            release();
+            data = other.data;
+            size = other.size;
+            other.data = nullptr;
+            other.size = 0;
+        }
+        return *this;
+    }
+
+    MappedFile(const MappedFile &) = delete;
+    MappedFile &operator=(const MappedFile &) = delete;
+
+    ~MappedFile()
+    {
+        release();
+    }
+
+    bool valid() const { return data != nullptr; }
+    const unsigned char *bytes() const { return data; }
+    size_t length() const { return size; }
+
+private:
+    const unsigned char *data;
+    size_t size;
+
+    void release()
+    {
+        if (data)
+            munmap((void *)data, size);
+        data = nullptr;
+        size = 0;
+    }
+};
+
+class AssetCache
+{
+public:
+    // hash of a file's contents, or 0 if the file can't be read
+    static uint64_t HashFile(const std::string &path, uint64_t seed = FNV_OFFSET_BASIS)
+    {
+        MappedFile file(path);
+        if (!file.valid())
+            return 0;
+        return fnv1a(file.bytes(), file.length(), seed);
+    }
+
+    // writes to a temporary file first and renames it into place, so a crash never leaves a torn cache behind
+    static bool WriteFile(const std::string &path, const std::string &contents)
+    {
+        std::string tmpPath = path + ".tmp";
+        {
+            std::ofstream out(tmpPath, std::ios::binary | std::ios::trunc);
+            if (!out)
+                return false;
+            out.write(contents.data(), contents.size());
+            if (!out)
+                return false;
+        }
+        return std::rename(tmpPath.c_str(), path.c_str()) == 0;
+    }
+};
+
+// appends raw bytes to a cache blob and pads it so the next section starts aligned
+inline void appendAligned(std::string &blob, const void *data, size_t size, size_t alignment = 16)
+{
+    blob.append((const char *)data, size);
+    size_t padding = (alignment - blob.size() % alignment) % alignment;
+    blob.append(padding, '\0');
+}
+#endif
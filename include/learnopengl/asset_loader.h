@@ -0,0 +1,280 @@
+#ifndef ASSET_LOADER_H
+#define ASSET_LOADER_H
+
+#include <learnopengl/model.h>
+#include <learnopengl/parallel.h>
+#include <learnopengl/texture_loader.h>
+#include <learnopengl/texture_registry.h>
+
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <condition_variable>
+#include <deque>
+#include <functional>
+#include <iomanip>
+#include <iostream>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <thread>
+#include <vector>
+
+// lock-free multi-producer/single-consumer queue (Vyukov's intrusive list with a stub node).
+// any thread may Push, only one thread may Pop.
+template <typename T>
+class MpscQueue
+{
+public:
+    MpscQueue() : head(new Node()), tail(head.load())
+    {
+    }
+
+    ~MpscQueue()
+    {
+        T value;
+        while (Pop(value))
+            ;
+        delete tail;
+    }
+
+    MpscQueue(const MpscQueue &) = delete;
+    MpscQueue &operator=(const MpscQueue &) = delete;
+
+    void Push(T value)
+    {
+        Node *node = new Node();
+        node->value = std::move(value);
+        Node *previous = head.exchange(node, std::memory_order_acq_rel);
+        previous->next.store(node, std::memory_order_release);
+    }
+
+    bool Pop(T &value)
+    {
+        Node *next = tail->next.load(std::memory_order_acquire);
+        if (!next)
+            return false;
+        value = std::move(next->value);
+        delete tail;
+        tail = next;
+        return true;
+    }
+
+private:
+    struct Node {
+        std::atomic<Node *> next{nullptr};
+        T value;
+    };
+
+    std::atomic<Node *> head;
+    Node *tail;
+};
+
+// fixed set of worker threads draining a shared job queue
+class ThreadPool
+{
+public:
+    explicit ThreadPool(unsigned int threadCount = 0) : stopping(false)
+    {
+        if (threadCount == 0)
+            threadCount = std::max(1u, std::thread::hardware_concurrency());
+        for (unsigned int i = 0; i < threadCount; i++)
+            workers.emplace_back([this]() { work(); });
+    }
+
+    ~ThreadPool()
+    {
+        {
+            std::lock_guard<std::mutex> lock(mutex);
+            stopping = true;
+        }
+        wakeup.notify_all();
+        for (std::thread &worker: workers)
+            worker.join();
+    }
+
+    ThreadPool(const ThreadPool &) = delete;
+    ThreadPool &operator=(const ThreadPool &) = delete;
+
+    void Submit(std::function<void()> job)
+    {
+        {
+            std::lock_guard<std::mutex> lock(mutex);
+            jobs.push_back(std::move(job));
+        }
+        wakeup.notify_one();
+    }
+
+    unsigned int Size() const
+    {
+        return workers.size();
+    }
+
+private:
+    std::vector<std::thread> workers;
+    std::deque<std::function<void()>> jobs;
+    std::mutex mutex;
+    std::condition_variable wakeup;
+    bool stopping;
+
+    void work()
+    {
+        InParallelWork() = true;
+        for (;;)
+        {
+            std::function<void()> job;
+            {
+                std::unique_lock<std::mutex> lock(mutex);
+                wakeup.wait(lock, [this]() { return stopping || !jobs.empty(); });
+                if (stopping && jobs.empty())
+                    return;
+                job = std::move(jobs.front());
+                jobs.pop_front();
+            }
+            job();
+        }
+    }
+};
+
+struct AssetTiming {
+    std::string name;
+    float cpuMs;    // decode/import on a worker
+    float uploadMs; // GL upload on the GL thread
+};
+
+// Loads textures, cubemaps and models in the background: decoding and importing run on a worker pool and the
+// finished CPU buffers are handed to the GL thread through a lock-free queue, where Poll/Finish upload them.
+// The ids/models passed in are written on the GL thread during Poll/Finish, so they have to outlive the loader's work.
+class AssetLoader
+{
+public:
+    explicit AssetLoader(unsigned int threadCount = 0) : pending(0), pool(threadCount)
+    {
+        start = std::chrono::steady_clock::now();
+    }
+
+    void LoadTexture(const std::string &path, unsigned int &textureID)
+    {
+        unsigned int *target = &textureID;
+        submit(path, [path, target]() {
+            // images already resident in the registry are not decoded again
+            uint64_t key = TextureRegistry::Key(path);
+            auto image = std::make_shared<TextureImage>();
+            if (!TextureRegistry::Contains(key))
+                *image = TextureLoader::Decode(path);
+            return std::function<void()>([image, key, path, target]() {
+                *target = TextureRegistry::Acquire(key);
+                if (*target == 0)
+                    *target = image->path.empty() ? TextureRegistry::Load2D(path) : TextureRegistry::Insert(key, TextureStreamer::Upload2D(std::move(*image)));
+                TextureLoader::Free(*image);
+            });
+        });
+    }
+
+    void LoadCubemap(const std::vector<std::string> &paths, unsigned int &textureID)
+    {
+        unsigned int *target = &textureID;
+        submit(paths.empty() ? std::string("cubemap") : paths[0], [paths, target]() {
+            uint64_t key = TextureRegistry::CubemapKey(paths);
+            auto faces = std::make_shared<std::vector<TextureImage>>();
+            if (!TextureRegistry::Contains(key))
+                for (const std::string &path: paths)
+                    faces->push_back(TextureLoader::Decode(path));
+            return std::function<void()>([faces, key, paths, target]() {
+                *target = TextureRegistry::Acquire(key);
+                if (*target == 0)
+                    *target = faces->empty() ? TextureRegistry::LoadCubemap(paths) : TextureRegistry::Insert(key, TextureLoader::UploadCubemap(*faces));
+                for (TextureImage &face: *faces)
+                    TextureLoader::Free(face);
+            });
+        });
+    }
+
+    void LoadModel(Model &model, const std::string &path)
+    {
+        Model *target = &model;
+        submit(path, [path, target]() {
+            auto data = std::make_shared<ModelData>();
+            bool imported = Model::Import(path, *data);
+            if (imported)
+                Model::DecodeTextures(*data);
+            return std::function<void()>([data, imported, target]() {
+                if (imported)
+                    target->Upload(*data);
+            });
+        });
+    }
+
+    // uploads whatever the workers have finished so far. call from the GL thread, e.g. once per frame.
+    // returns the number of assets still in flight.
+    unsigned int Poll()
+    {
+        Ready ready;
+        while (completed.Pop(ready))
+        {
+            auto uploadStart = std::chrono::steady_clock::now();
+            ready.upload();
+            float uploadMs = std::chrono::duration<float, std::milli>(std::chrono::steady_clock::now() - uploadStart).count();
+            timings.push_back(AssetTiming{ready.name, ready.cpuMs, uploadMs});
+            pending--;
+        }
+        return pending;
+    }
+
+    // blocks the GL thread until every submitted asset is uploaded, then reports the timings
+    void Finish()
+    {
+        while (Poll() > 0)
+            std::this_thread::sleep_for(std::chrono::microseconds(100));
+
+        float wallMs = std::chrono::duration<float, std::milli>(std::chrono::steady_clock::now() - start).count();
+        float serialMs = 0.0f;
+        std::cout << "Asset loading (" << pool.Size() << " workers):" << std::endl;
+        std::streamsize precision = std::cout.precision();
+        std::cout << std::fixed << std::setprecision(1);
+        for (const AssetTiming &timing: timings)
+        {
+            std::cout << "  " << std::setw(8) << timing.cpuMs << " ms cpu " << std::setw(7) << timing.uploadMs
+                      << " ms upload  " << timing.name << std::endl;
+            serialMs += timing.cpuMs + timing.uploadMs;
+        }
+        std::cout << "  total " << wallMs << " ms wall, " << serialMs << " ms if loaded one after another" << std::endl;
+        TextureRegistryStats textures = TextureRegistry::Stats();
+        std::cout << "  " << textures.textures << " unique textures, " << textures.hits << " shared loads" << std::endl;
+        std::cout.unsetf(std::ios::fixed);
+        std::cout.precision(precision);
+    }
+
+    const std::vector<AssetTiming> &Timings() const
+    {
+        return timings;
+    }
+
+private:
+    struct Ready {
+        std::string name;
+        float cpuMs;
+        std::function<void()> upload;
+    };
+
+    MpscQueue<Ready> completed;
+    unsigned int pending;
+    std::vector<AssetTiming> timings;
+    std::chrono::steady_clock::time_point start;
+    // declared last so the workers are joined before the queue they push into is destroyed
+    ThreadPool pool;
+
+    // runs decode on a worker; the GL closure it returns is queued for the GL thread
+    void submit(const std::string &name, std::function<std::function<void()>()> decode)
+    {
+        pending++;
+        MpscQueue<Ready> *queue = &completed;
+        pool.Submit([name, decode, queue]() {
+            auto cpuStart = std::chrono::steady_clock::now();
+            std::function<void()> upload = decode();
+            float cpuMs = std::chrono::duration<float, std::milli>(std::chrono::steady_clock::now() - cpuStart).count();
+            queue->Push(Ready{name, cpuMs, std::move(upload)});
+        });
+    }
+};
+#endif
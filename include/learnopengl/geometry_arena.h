@@ -0,0 +1,456 @@
+#ifndef GEOMETRY_ARENA_H
+#define GEOMETRY_ARENA_H
+
+#include <glad/glad.h>
+
+#include <learnopengl/gl_state.h>
+#include <learnopengl/vertex_format.h>
+
+#include <algorithm>
+#include <cstdint>
+#include <cstring>
+#include <memory>
+#include <vector>
+
+// usage of one of the arena's buffers, in bytes
+struct GeometryBufferStats {
+    size_t capacity = 0;
+    size_t used = 0;
+    size_t freeBlocks = 0;       // number of holes, the tail counts as one
+    size_t largestFreeBlock = 0;
+    float fragmentation = 0.0f;  // 1 - largest free block / free bytes: 0 when all free space is contiguous
+};
+
+struct GeometryArenaStats {
+    GeometryBufferStats vertices;
+    GeometryBufferStats indices;
+    size_t allocations = 0; // live ranges
+    size_t growths = 0;
+    size_t compactions = 0;
+};
+
+// first-fit allocator over the byte range of a buffer, free blocks kept sorted by offset and coalesced
+class RangeAllocator
+{
+public:
+    explicit RangeAllocator(size_t capacity = 0)
+    {
+        Reset(0, capacity);
+    }
+
+    bool Allocate(size_t size, size_t &offset)
+    {
+        for (size_t i = 0; i < freeList.size(); i++)
+        {
+            Block &block = freeList[i];
+            if (block.size < size)
+                continue;
+            offset = block.offset;
+            block.offset += size;
+            block.size -= size;
+            if (block.size == 0)
+                freeList.erase(freeList.begin() + i);
+            used += size;
+            return true;
+        }
+        return false;
+    }
+
+    void Free(size_t offset, size_t size)
+    {
+        if (size == 0)
+            return;
+        auto next = std::lower_bound(freeList.begin(), freeList.end(), offset,
+                                     [](const Block &block, size_t value) { return block.offset < value; });
+        next = freeList.insert(next, Block{offset, size});
+        // merge with the following, then with the preceding block
+        if (next + 1 != freeList.end() && next->offset + next->size == (next + 1)->offset)
+        {
+            next->size += (next + 1)->size;
+            freeList.erase(next + 1);
+        }
+        if (next != freeList.begin() && (next - 1)->offset + (next - 1)->size == next->offset)
+        {
+            (next - 1)->size += next->size;
+            freeList.erase(next);
+        }
+        used -= size;
+    }
+
+    // the range [capacity, newCapacity) becomes free
+    void Grow(size_t newCapacity)
+    {
+        if (newCapacity > capacity)
+        {
+            size_t oldCapacity = capacity;
+            capacity = newCapacity;
+            used += newCapacity - oldCapacity; // Free takes it off again
+            Free(oldCapacity, newCapacity - oldCapacity);
+        }
+    }
+
+    // everything below `usedBytes` is allocated, the rest is one free block
+    void Reset(size_t usedBytes, size_t newCapacity)
+    {
+        capacity = newCapacity;
+        used = usedBytes;
+        freeList.clear();
+        if (usedBytes < newCapacity)
+            freeList.push_back(Block{usedBytes, newCapacity - usedBytes});
+    }
+
+    size_t Capacity() const
+    {
+        return capacity;
+    }
+
+    GeometryBufferStats Stats() const
+    {
+        GeometryBufferStats stats;
+        stats.capacity = capacity;
+        stats.used = used;
+        stats.freeBlocks = freeList.size();
+        size_t freeBytes = 0;
+        for (const Block &block: freeList)
+        {
+            freeBytes += block.size;
+            stats.largestFreeBlock = std::max(stats.largestFreeBlock, block.size);
+        }
+        stats.fragmentation = freeBytes > 0 ? 1.0f - (float)stats.largestFreeBlock / freeBytes : 0.0f;
+        return stats;
+    }
+
+private:
+    struct Block {
+        size_t offset;
+        size_t size;
+    };
+
+    std::vector<Block> freeList;
+    size_t capacity = 0;
+    size_t used = 0;
+};
+
+// One vertex buffer, one index buffer and one VAO shared by all geometry of a vertex format.
+// Meshes get a handle to a sub-range and draw it with glDrawElementsBaseVertex, so consecutive draws of the
+// same format never rebind the VAO. Ranges can be freed, which leaves holes that Compact closes again by
+// copying the live ranges down on the GPU; handles stay valid across growth and compaction.
+// All functions have to run on the GL thread.
+class GeometryArena
+{
+public:
+    typedef unsigned int Handle;
+    static const Handle INVALID_HANDLE = ~0u;
+
+    explicit GeometryArena(VertexFormat format, size_t vertexBytes = 4 << 20, size_t indexBytes = 1 << 20)
+        : format(format), stride(VertexLayout::Stride(format)),
+          vertexAllocator(vertexBytes / stride * stride), indexAllocator(indexBytes & ~(size_t)3)
+    {
+        glGenVertexArrays(1, &VAO);
+        VBO = createBuffer(vertexAllocator.Capacity());
+        EBO = createBuffer(indexAllocator.Capacity());
+        attachBuffers();
+    }
+
+    ~GeometryArena()
+    {
+        GLState::VertexArrayDeleted(VAO);
+        glDeleteVertexArrays(1, &VAO);
+        glDeleteBuffers(1, &VBO);
+        glDeleteBuffers(1, &EBO);
+    }
+
+    GeometryArena(const GeometryArena &) = delete;
+    GeometryArena &operator=(const GeometryArena &) = delete;
+
+    // the shared arena of a vertex format, created on first use
+    static GeometryArena &For(VertexFormat format)
+    {
+        std::unique_ptr<GeometryArena> &arena = arenas()[(int)format];
+        if (!arena)
+            arena.reset(new GeometryArena(format));
+        return *arena;
+    }
+
+    // the arena of a format if anything created it yet, null otherwise
+    static GeometryArena *Find(VertexFormat format)
+    {
+        return arenas()[(int)format].get();
+    }
+
+    // deletes the GL objects of all arenas. call before the context goes away.
+    static void DestroyAll()
+    {
+        for (std::unique_ptr<GeometryArena> &arena: arenas())
+            arena.reset();
+    }
+
+    static GLenum IndexType(size_t vertexCount)
+    {
+        if (vertexCount <= 0x100)
+            return GL_UNSIGNED_BYTE;
+        if (vertexCount <= 0x10000)
+            return GL_UNSIGNED_SHORT;
+        return GL_UNSIGNED_INT;
+    }
+
+    static size_t IndexSize(GLenum indexType)
+    {
+        return indexType == GL_UNSIGNED_BYTE ? 1 : indexType == GL_UNSIGNED_SHORT ? 2 : 4;
+    }
+
+    // copies `vertexCount` vertices laid out in this arena's format and their indices into the arena.
+    // indices are stored in the smallest type that addresses all vertices; without indices the vertices are
+    // drawn in order. the buffers grow when nothing fits.
+    Handle Allocate(const void *vertices, size_t vertexCount, const std::vector<unsigned int> &indices = std::vector<unsigned int>())
+    {
+        Range range;
+        range.indexType = IndexType(vertexCount);
+        range.indexCount = indices.empty() ? vertexCount : indices.size();
+        range.vertexBytes = vertexCount * stride;
+        // index ranges are kept 4-byte aligned so any index type can follow any other
+        range.indexBytes = (range.indexCount * IndexSize(range.indexType) + 3) & ~(size_t)3;
+
+        if (!vertexAllocator.Allocate(range.vertexBytes, range.vertexOffset))
+        {
+            grow(VBO, vertexAllocator, range.vertexBytes);
+            vertexAllocator.Allocate(range.vertexBytes, range.vertexOffset);
+        }
+        if (!indexAllocator.Allocate(range.indexBytes, range.indexOffset))
+        {
+            grow(EBO, indexAllocator, range.indexBytes);
+            indexAllocator.Allocate(range.indexBytes, range.indexOffset);
+        }
+
+        // uploads go through the copy target so the element binding of whatever VAO is bound stays untouched
+        glBindBuffer(GL_COPY_WRITE_BUFFER, VBO);
+        glBufferSubData(GL_COPY_WRITE_BUFFER, range.vertexOffset, range.vertexBytes, vertices);
+        glBindBuffer(GL_COPY_WRITE_BUFFER, EBO);
+        std::vector<unsigned char> narrow = narrowIndices(indices, range.indexCount, range.indexType);
+        glBufferSubData(GL_COPY_WRITE_BUFFER, range.indexOffset, narrow.size(), narrow.data());
+        glBindBuffer(GL_COPY_WRITE_BUFFER, 0);
+
+        range.live = true;
+        Handle handle;
+        if (!freeHandles.empty())
+        {
+            handle = freeHandles.back();
+            freeHandles.pop_back();
+            ranges[handle] = range;
+        }
+        else
+        {
+            handle = ranges.size();
+            ranges.push_back(range);
+        }
+        stats.allocations++;
+        return handle;
+    }
+
+    void Free(Handle handle)
+    {
+        if (handle >= ranges.size() || !ranges[handle].live)
+            return;
+        Range &range = ranges[handle];
+        vertexAllocator.Free(range.vertexOffset, range.vertexBytes);
+        indexAllocator.Free(range.indexOffset, range.indexBytes);
+        range.live = false;
+        freeHandles.push_back(handle);
+        stats.allocations--;
+    }
+
+    void Draw(Handle handle, GLenum mode = GL_TRIANGLES)
+    {
+        const Range &range = ranges[handle];
+        Bind();
+        glDrawElementsBaseVertex(mode, range.indexCount, range.indexType, (void*)range.indexOffset,
+                                 (GLint)(range.vertexOffset / stride));
+    }
+
+    // draws `indexCount` indices of the range starting at `firstIndex`, e.g. one LOD out of several stored back to back
+    void DrawRange(Handle handle, size_t firstIndex, size_t indexCount, GLenum mode = GL_TRIANGLES)
+    {
+        const Range &range = ranges[handle];
+        Bind();
+        glDrawElementsBaseVertex(mode, indexCount, range.indexType, (void*)(range.indexOffset + firstIndex * IndexSize(range.indexType)),
+                                 (GLint)(range.vertexOffset / stride));
+    }
+
+    // draws several sub-ranges of one range with a single call, `firstIndices` relative to the range like DrawRange
+    void DrawRanges(Handle handle, const std::vector<GLsizei> &counts, const std::vector<size_t> &firstIndices, GLenum mode = GL_TRIANGLES)
+    {
+        const Range &range = ranges[handle];
+        Bind();
+        offsets.resize(counts.size());
+        baseVertices.assign(counts.size(), (GLint)(range.vertexOffset / stride));
+        for (size_t i = 0; i < counts.size(); i++)
+            offsets[i] = (const void*)(range.indexOffset + firstIndices[i] * IndexSize(range.indexType));
+        glMultiDrawElementsBaseVertex(mode, counts.data(), range.indexType, offsets.data(), counts.size(), baseVertices.data());
+    }
+
+    // binds the arena VAO unless it already is, see GLState. code binding VAOs behind its back has to call
+    // InvalidateBinding afterwards.
+    void Bind()
+    {
+        GLState::BindVertexArray(VAO);
+    }
+
+    static void InvalidateBinding()
+    {
+        GLState::InvalidateVertexArray();
+    }
+
+    // moves all live ranges to the front of their buffers, leaving a single free block at the end
+    void Compact()
+    {
+        std::vector<Handle> live;
+        for (Handle handle = 0; handle < ranges.size(); handle++)
+            if (ranges[handle].live)
+                live.push_back(handle);
+
+        std::sort(live.begin(), live.end(), [this](Handle a, Handle b) { return ranges[a].vertexOffset < ranges[b].vertexOffset; });
+        GLuint vertices = createBuffer(vertexAllocator.Capacity());
+        size_t vertexEnd = 0;
+        glBindBuffer(GL_COPY_READ_BUFFER, VBO);
+        glBindBuffer(GL_COPY_WRITE_BUFFER, vertices);
+        for (Handle handle: live)
+        {
+            Range &range = ranges[handle];
+            glCopyBufferSubData(GL_COPY_READ_BUFFER, GL_COPY_WRITE_BUFFER, range.vertexOffset, vertexEnd, range.vertexBytes);
+            range.vertexOffset = vertexEnd;
+            vertexEnd += range.vertexBytes;
+        }
+
+        std::sort(live.begin(), live.end(), [this](Handle a, Handle b) { return ranges[a].indexOffset < ranges[b].indexOffset; });
+        GLuint indices = createBuffer(indexAllocator.Capacity());
+        size_t indexEnd = 0;
+        glBindBuffer(GL_COPY_READ_BUFFER, EBO);
+        glBindBuffer(GL_COPY_WRITE_BUFFER, indices);
+        for (Handle handle: live)
+        {
+            Range &range = ranges[handle];
+            glCopyBufferSubData(GL_COPY_READ_BUFFER, GL_COPY_WRITE_BUFFER, range.indexOffset, indexEnd, range.indexBytes);
+            range.indexOffset = indexEnd;
+            indexEnd += range.indexBytes;
+        }
+        glBindBuffer(GL_COPY_READ_BUFFER, 0);
+        glBindBuffer(GL_COPY_WRITE_BUFFER, 0);
+
+        glDeleteBuffers(1, &VBO);
+        glDeleteBuffers(1, &EBO);
+        VBO = vertices;
+        EBO = indices;
+        vertexAllocator.Reset(vertexEnd, vertexAllocator.Capacity());
+        indexAllocator.Reset(indexEnd, indexAllocator.Capacity());
+        attachBuffers();
+        stats.compactions++;
+    }
+
+    // compacts when either buffer's free space is split up more than `threshold` (see GeometryBufferStats)
+    bool CompactIfFragmented(float threshold = 0.5f)
+    {
+        if (vertexAllocator.Stats().fragmentation <= threshold && indexAllocator.Stats().fragmentation <= threshold)
+            return false;
+        Compact();
+        return true;
+    }
+
+    GeometryArenaStats Stats() const
+    {
+        GeometryArenaStats result = stats;
+        result.vertices = vertexAllocator.Stats();
+        result.indices = indexAllocator.Stats();
+        return result;
+    }
+
+    VertexFormat Format() const
+    {
+        return format;
+    }
+
+private:
+    struct Range {
+        size_t vertexOffset = 0;
+        size_t vertexBytes = 0;
+        size_t indexOffset = 0;
+        size_t indexBytes = 0;
+        size_t indexCount = 0;
+        GLenum indexType = GL_UNSIGNED_INT;
+        bool live = false;
+    };
+
+    VertexFormat format;
+    GLsizei stride;
+    GLuint VAO, VBO, EBO;
+    RangeAllocator vertexAllocator;
+    RangeAllocator indexAllocator;
+    std::vector<Range> ranges;
+    std::vector<Handle> freeHandles;
+    GeometryArenaStats stats;
+    std::vector<const void*> offsets;  // scratch for DrawRanges
+    std::vector<GLint> baseVertices;
+
+    static std::unique_ptr<GeometryArena> (&arenas())[(int)VertexFormat::Count]
+    {
+        static std::unique_ptr<GeometryArena> instances[(int)VertexFormat::Count];
+        return instances;
+    }
+
+    static GLuint createBuffer(size_t size)
+    {
+        GLuint buffer;
+        glGenBuffers(1, &buffer);
+        glBindBuffer(GL_COPY_WRITE_BUFFER, buffer);
+        glBufferData(GL_COPY_WRITE_BUFFER, size, nullptr, GL_DYNAMIC_DRAW);
+        glBindBuffer(GL_COPY_WRITE_BUFFER, 0);
+        return buffer;
+    }
+
+    // points the VAO at the current buffers, needed whenever one of them was replaced
+    void attachBuffers()
+    {
+        GLState::BindVertexArray(VAO);
+        glBindBuffer(GL_ARRAY_BUFFER, VBO);
+        VertexLayout::Setup(format);
+        glBindBuffer(GL_ELEMENT_ARRAY_BUFFER, EBO);
+    }
+
+    // replaces `buffer` by one at least twice as large, keeping its contents
+    void grow(GLuint &buffer, RangeAllocator &allocator, size_t needed)
+    {
+        size_t oldCapacity = allocator.Capacity();
+        size_t newCapacity = std::max(oldCapacity * 2, oldCapacity + needed);
+        GLuint grown = createBuffer(newCapacity);
+        glBindBuffer(GL_COPY_READ_BUFFER, buffer);
+        glBindBuffer(GL_COPY_WRITE_BUFFER, grown);
+        glCopyBufferSubData(GL_COPY_READ_BUFFER, GL_COPY_WRITE_BUFFER, 0, 0, oldCapacity);
+        glBindBuffer(GL_COPY_READ_BUFFER, 0);
+        glBindBuffer(GL_COPY_WRITE_BUFFER, 0);
+        glDeleteBuffers(1, &buffer);
+        buffer = grown;
+        allocator.Grow(newCapacity);
+        attachBuffers();
+        stats.growths++;
+    }
+
+    static std::vector<unsigned char> narrowIndices(const std::vector<unsigned int> &indices, size_t count, GLenum indexType)
+    {
+        size_t size = IndexSize(indexType);
+        std::vector<unsigned char> narrow(count * size);
+        for (size_t i = 0; i < count; i++)
+        {
+            uint32_t index = indices.empty() ? (uint32_t)i : indices[i];
+            if (size == 1)
+                narrow[i] = (unsigned char)index;
+            else if (size == 2)
+            {
+                uint16_t value = (uint16_t)index;
+                memcpy(&narrow[2 * i], &value, 2);
+            }
+            else
+                memcpy(&narrow[4 * i], &index, 4);
+        }
+        return narrow;
+    }
+};
+#endif
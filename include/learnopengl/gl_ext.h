@@ -0,0 +1,88 @@
+#ifndef GL_EXT_H
+#define GL_EXT_H
+
+#include <glad/glad.h>
+
+#include <cstring>
+
+// enums of the entry points below; glad is generated for plain 3.3 core, without extensions
+#ifndef GL_PROGRAM_BINARY_RETRIEVABLE_HINT
+#define GL_PROGRAM_BINARY_RETRIEVABLE_HINT 0x8257
+#endif
+#ifndef GL_PROGRAM_BINARY_LENGTH
+#define GL_PROGRAM_BINARY_LENGTH 0x8741
+#endif
+#ifndef GL_NUM_PROGRAM_BINARY_FORMATS
+#define GL_NUM_PROGRAM_BINARY_FORMATS 0x87FE
+#endif
+#ifndef GL_COMPLETION_STATUS_KHR
+#define GL_COMPLETION_STATUS_KHR 0x91B1
+#endif
+
+// Entry points past the 3.3 core that glad loads, resolved at runtime where the driver has them. Each group has a
+// flag telling whether it can be used; the function pointers are null otherwise.
+//  - programBinary: glGetProgramBinary/glProgramBinary/glProgramParameteri (GL 4.1 or ARB_get_program_binary),
+//    with at least one binary format, see ProgramCache
+//  - parallelShaderCompile: KHR/ARB_parallel_shader_compile, compiles and links return at once and the driver's
+//    threads do the work; GL_COMPLETION_STATUS_KHR tells when a shader or program is done, see Shader::Ready
+class GLExtensions
+{
+public:
+    typedef void (APIENTRYP GetProgramBinaryProc)(GLuint program, GLsizei bufSize, GLsizei *length, GLenum *binaryFormat, void *binary);
+    typedef void (APIENTRYP ProgramBinaryProc)(GLuint program, GLenum binaryFormat, const void *binary, GLsizei length);
+    typedef void (APIENTRYP ProgramParameteriProc)(GLuint program, GLenum pname, GLint value);
+    typedef void (APIENTRYP MaxShaderCompilerThreadsProc)(GLuint count);
+
+    bool programBinary = false;
+    GetProgramBinaryProc GetProgramBinary = nullptr;
+    ProgramBinaryProc ProgramBinary = nullptr;
+    ProgramParameteriProc ProgramParameteri = nullptr;
+    bool parallelShaderCompile = false;
+    MaxShaderCompilerThreadsProc MaxShaderCompilerThreads = nullptr;
+
+    // call once on the GL thread, right after gladLoadGLLoader and with the same loader
+    static void Load(GLADloadproc load)
+    {
+        GLExtensions &ext = Get();
+        GLint major = 0, minor = 0;
+        glGetIntegerv(GL_MAJOR_VERSION, &major);
+        glGetIntegerv(GL_MINOR_VERSION, &minor);
+        bool gl41 = major > 4 || (major == 4 && minor >= 1);
+
+        if (gl41 || Has("GL_ARB_get_program_binary"))
+        {
+            ext.GetProgramBinary = (GetProgramBinaryProc)load("glGetProgramBinary");
+            ext.ProgramBinary = (ProgramBinaryProc)load("glProgramBinary");
+            ext.ProgramParameteri = (ProgramParameteriProc)load("glProgramParameteri");
+            GLint formats = 0;
+            glGetIntegerv(GL_NUM_PROGRAM_BINARY_FORMATS, &formats);
+            ext.programBinary = ext.GetProgramBinary && ext.ProgramBinary && ext.ProgramParameteri && formats > 0;
+        }
+
+        if (Has("GL_KHR_parallel_shader_compile"))
+            ext.MaxShaderCompilerThreads = (MaxShaderCompilerThreadsProc)load("glMaxShaderCompilerThreadsKHR");
+        else if (Has("GL_ARB_parallel_shader_compile"))
+            ext.MaxShaderCompilerThreads = (MaxShaderCompilerThreadsProc)load("glMaxShaderCompilerThreadsARB");
+        ext.parallelShaderCompile = ext.MaxShaderCompilerThreads != nullptr;
+        // as many threads as the driver likes; some only compile in parallel once asked to
+        if (ext.parallelShaderCompile)
+            ext.MaxShaderCompilerThreads(0xFFFFFFFF);
+    }
+
+    static GLExtensions &Get()
+    {
+        static GLExtensions extensions;
+        return extensions;
+    }
+
+    static bool Has(const char *name)
+    {
+        GLint count = 0;
+        glGetIntegerv(GL_NUM_EXTENSIONS, &count);
+        for (GLint i = 0; i < count; i++)
+            if (strcmp((const char *)glGetStringi(GL_EXTENSIONS, i), name) == 0)
+                return true;
+        return false;
+    }
+};
+#endif
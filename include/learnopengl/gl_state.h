@@ -0,0 +1,213 @@
+#ifndef GL_STATE_H
+#define GL_STATE_H
+
+#include <glad/glad.h>
+
+// calls that went to GL and calls skipped because the state was already set, per kind of state; cleared per
+// frame by ResetFrame
+struct GLStateStats {
+    enum Kind { Program, VertexArray, Texture, Capability, Function, Framebuffer, Count };
+
+    size_t calls[Count] = {};
+    size_t skipped[Count] = {};
+
+    void ResetFrame()
+    {
+        for (int i = 0; i < Count; i++)
+            calls[i] = skipped[i] = 0;
+    }
+
+    static const char *Name(Kind kind)
+    {
+        static const char *names[] = {"program", "vertex array", "textures", "enables", "blend/depth/cull", "framebuffer"};
+        return names[kind];
+    }
+};
+
+// Shadow of the GL state the render loop changes: program, VAO, textures per unit (2D and cube map), blend,
+// depth test and culling with their functions, and the draw framebuffer. Setting what is already set is
+// skipped. The shadow starts out unknown, so the first call always goes through; code changing the same state
+// behind GLState's back (loaders, the texture streamer, ImGui) has to invalidate what it touched afterwards.
+// Enables of other capabilities and units past MAX_UNITS go straight to GL.
+class GLState
+{
+public:
+    static const GLuint MAX_UNITS = 16;
+
+    // returns whether glUseProgram was called
+    static bool UseProgram(GLuint program)
+    {
+        if (!set(state().program, program, GLStateStats::Program))
+            return false;
+        glUseProgram(program);
+        return true;
+    }
+
+    static bool IsProgram(GLuint program)
+    {
+        return state().program == program;
+    }
+
+    static void BindVertexArray(GLuint vao)
+    {
+        if (set(state().vertexArray, vao, GLStateStats::VertexArray))
+            glBindVertexArray(vao);
+    }
+
+    // a deleted VAO that was bound leaves 0 bound
+    static void VertexArrayDeleted(GLuint vao)
+    {
+        if (state().vertexArray == vao)
+            state().vertexArray = 0;
+    }
+
+    // deleting a texture unbinds it from every unit, and its name may come back for a new one
+    static void TextureDeleted(GLuint texture)
+    {
+        State &s = state();
+        for (GLuint unit = 0; unit < MAX_UNITS; unit++)
+            for (GLuint &bound: s.textures[unit])
+                if (bound == texture)
+                    bound = 0;
+    }
+
+    // binds `texture` to `unit`, making it the active unit if the binding changes
+    static void BindTexture(GLuint unit, GLenum target, GLuint texture)
+    {
+        State &s = state();
+        int slot = target == GL_TEXTURE_2D ? 0 : target == GL_TEXTURE_CUBE_MAP ? 1 : -1;
+        if (unit < MAX_UNITS && slot >= 0 && !set(s.textures[unit][slot], texture, GLStateStats::Texture))
+            return;
+        if (set(s.activeUnit, unit, GLStateStats::Texture))
+            glActiveTexture(GL_TEXTURE0 + unit);
+        glBindTexture(target, texture);
+    }
+
+    static void Enable(GLenum capability)
+    {
+        Set(capability, true);
+    }
+
+    static void Disable(GLenum capability)
+    {
+        Set(capability, false);
+    }
+
+    static void Set(GLenum capability, bool enabled)
+    {
+        GLuint *tracked = capability == GL_BLEND ? &state().blend :
+                          capability == GL_DEPTH_TEST ? &state().depthTest :
+                          capability == GL_CULL_FACE ? &state().cullFace : nullptr;
+        if (tracked && !set(*tracked, enabled, GLStateStats::Capability))
+            return;
+        if (enabled)
+            glEnable(capability);
+        else
+            glDisable(capability);
+    }
+
+    static void BlendFunc(GLenum source, GLenum destination)
+    {
+        State &s = state();
+        if (s.blendSource == source && s.blendDestination == destination)
+        {
+            Stats().skipped[GLStateStats::Function]++;
+            return;
+        }
+        s.blendSource = source;
+        s.blendDestination = destination;
+        Stats().calls[GLStateStats::Function]++;
+        glBlendFunc(source, destination);
+    }
+
+    static void DepthFunc(GLenum function)
+    {
+        if (set(state().depthFunction, function, GLStateStats::Function))
+            glDepthFunc(function);
+    }
+
+    static void CullFace(GLenum mode)
+    {
+        if (set(state().cullMode, mode, GLStateStats::Function))
+            glCullFace(mode);
+    }
+
+    // binds GL_FRAMEBUFFER
+    static void BindFramebuffer(GLuint framebuffer)
+    {
+        if (set(state().framebuffer, framebuffer, GLStateStats::Framebuffer))
+            glBindFramebuffer(GL_FRAMEBUFFER, framebuffer);
+    }
+
+    static void InvalidateProgram()
+    {
+        state().program = UNKNOWN;
+    }
+
+    static void InvalidateVertexArray()
+    {
+        state().vertexArray = UNKNOWN;
+    }
+
+    // the bindings of every unit and the active unit
+    static void InvalidateTextures()
+    {
+        State &s = state();
+        for (GLuint unit = 0; unit < MAX_UNITS; unit++)
+            s.textures[unit][0] = s.textures[unit][1] = UNKNOWN;
+        s.activeUnit = UNKNOWN;
+    }
+
+    static void Invalidate()
+    {
+        state() = State();
+    }
+
+    static GLStateStats &Stats()
+    {
+        static GLStateStats stats;
+        return stats;
+    }
+
+private:
+    static const GLuint UNKNOWN = ~0u;
+
+    // everything as GLuint, UNKNOWN until first set
+    struct State {
+        GLuint program = UNKNOWN;
+        GLuint vertexArray = UNKNOWN;
+        GLuint activeUnit = UNKNOWN;
+        GLuint textures[MAX_UNITS][2]; // GL_TEXTURE_2D, GL_TEXTURE_CUBE_MAP
+        GLuint blend = UNKNOWN, depthTest = UNKNOWN, cullFace = UNKNOWN;
+        GLuint blendSource = UNKNOWN, blendDestination = UNKNOWN;
+        GLuint depthFunction = UNKNOWN;
+        GLuint cullMode = UNKNOWN;
+        GLuint framebuffer = UNKNOWN;
+
+        State()
+        {
+            for (GLuint unit = 0; unit < MAX_UNITS; unit++)
+                textures[unit][0] = textures[unit][1] = UNKNOWN;
+        }
+    };
+
+    static State &state()
+    {
+        static State s;
+        return s;
+    }
+
+    // stores `value` and returns true if it differs from what was there, counting the call or the skip
+    static bool set(GLuint &current, GLuint value, GLStateStats::Kind kind)
+    {
+        if (current == value)
+        {
+            Stats().skipped[kind]++;
+            return false;
+        }
+        current = value;
+        Stats().calls[kind]++;
+        return true;
+    }
+};
+#endif
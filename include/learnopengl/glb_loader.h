@@ -0,0 +1,289 @@
+#ifndef GLB_LOADER_H
+#define GLB_LOADER_H
+
+#include <glad/glad.h>
+
+#include <glm/glm.hpp>
+
+#include <learnopengl/asset_cache.h>
+#include <learnopengl/hash.h>
+#include <learnopengl/json.h>
+#include <learnopengl/mesh.h>
+
+#include <cstring>
+#include <string>
+#include <vector>
+
+// one vertex attribute of a glTF primitive, straight from its accessor and buffer view
+struct GlbAttribute {
+    GLuint location;
+    GLint components;
+    GLenum type;
+    GLboolean normalized;
+    GLsizei stride;
+    size_t offset; // into the binary chunk
+};
+
+struct GlbPrimitive {
+    GLenum mode = GL_TRIANGLES;
+    std::vector<GlbAttribute> attributes;
+    bool indexed = false;
+    GLenum indexType = GL_UNSIGNED_INT;
+    size_t indexOffset = 0;
+    GLsizei count = 0;           // indices, or vertices when not indexed
+    glm::vec3 boundsMin, boundsMax;
+    std::vector<Texture> textures;
+};
+
+// an image embedded in the binary chunk
+struct GlbImage {
+    std::string name;
+    uint64_t key; // content hash, for the TextureRegistry
+    size_t offset;
+    size_t size;
+};
+
+// a mapped .glb file and what its JSON says about the binary chunk
+struct GlbAsset {
+    MappedFile file;
+    const unsigned char *binary = nullptr;
+    size_t binarySize = 0;
+    std::vector<GlbPrimitive> primitives;
+    std::vector<GlbImage> images;
+};
+
+// Zero-copy loading of binary glTF 2.0: the whole binary chunk goes into one GL buffer with a single
+// glBufferData straight from the mapping, and every primitive gets a VAO whose attribute pointers are the
+// accessors themselves (any component type, normalized or not, interleaved or not). No vertex is touched on
+// the CPU, so such meshes skip welding, optimization, clustering and LODs; bake those into the asset instead.
+// Attributes map to the usual locations: POSITION 0, NORMAL 1, TEXCOORD_0 2, TANGENT 3.
+// Node transforms are not applied, the assets are expected to be exported with transforms baked in.
+// Files using sparse accessors, external buffers or required extensions are rejected (Model then falls back to ASSIMP).
+class GlbLoader
+{
+public:
+    static bool Load(const std::string &path, GlbAsset &asset)
+    {
+        asset.file = MappedFile(path);
+        if (!asset.file.valid() || asset.file.length() < 20)
+            return false;
+        const unsigned char *base = asset.file.bytes();
+        uint32_t header[3];
+        memcpy(header, base, sizeof(header));
+        if (header[0] != 0x46546C67 || header[1] != 2 || header[2] > asset.file.length()) // "glTF", version 2
+            return false;
+
+        // JSON chunk first, then the optional binary chunk
+        const char *json = nullptr;
+        size_t jsonSize = 0;
+        for (size_t offset = 12; offset + 8 <= header[2];)
+        {
+            uint32_t chunk[2];
+            memcpy(chunk, base + offset, sizeof(chunk));
+            if (offset + 8 + chunk[0] > header[2])
+                return false;
+            if (chunk[1] == 0x4E4F534A && !json) // "JSON"
+            {
+                json = (const char *)base + offset + 8;
+                jsonSize = chunk[0];
+            }
+            else if (chunk[1] == 0x004E4942 && !asset.binary) // "BIN\0"
+            {
+                asset.binary = base + offset + 8;
+                asset.binarySize = chunk[0];
+            }
+            offset += 8 + ((chunk[0] + 3) & ~3u);
+        }
+        JsonValue gltf;
+        if (!json || !JsonValue::Parse(json, json + jsonSize, gltf) || gltf["extensionsRequired"].Size() > 0)
+            return false;
+        const JsonValue &buffers = gltf["buffers"];
+        if (buffers.Size() > 1 || (buffers.Size() == 1 && buffers[(size_t)0].Has("uri")))
+            return false;
+
+        std::string name = path.substr(path.find_last_of('/') + 1);
+        const JsonValue &images = gltf["images"];
+        for (size_t i = 0; i < images.Size(); i++)
+        {
+            const JsonValue &image = images[i];
+            if (!image.Has("bufferView"))
+                continue;
+            size_t offset, size;
+            if (!bufferView(gltf, image["bufferView"].AsInt(), offset, size))
+                return false;
+            GlbImage embedded;
+            embedded.name = name + "#image" + std::to_string(i);
+            embedded.key = fnv1a(asset.binary + offset, size);
+            embedded.offset = offset;
+            embedded.size = size;
+            asset.images.push_back(embedded);
+        }
+
+        const JsonValue &meshes = gltf["meshes"];
+        for (size_t m = 0; m < meshes.Size(); m++)
+        {
+            const JsonValue &primitives = meshes[m]["primitives"];
+            for (size_t p = 0; p < primitives.Size(); p++)
+            {
+                GlbPrimitive primitive;
+                if (!loadPrimitive(gltf, primitives[p], asset, name, primitive))
+                    return false;
+                asset.primitives.push_back(primitive);
+            }
+        }
+        return !asset.primitives.empty();
+    }
+
+    // the GL buffer holding the binary chunk, shared by all the asset's primitives
+    static GLuint UploadBuffer(const GlbAsset &asset)
+    {
+        GLuint buffer;
+        glGenBuffers(1, &buffer);
+        glBindBuffer(GL_ARRAY_BUFFER, buffer);
+        glBufferData(GL_ARRAY_BUFFER, asset.binarySize, asset.binary, GL_STATIC_DRAW);
+        return buffer;
+    }
+
+    static GLuint CreateVertexArray(const GlbPrimitive &primitive, GLuint buffer)
+    {
+        GLuint vao;
+        glGenVertexArrays(1, &vao);
+        glBindVertexArray(vao);
+        glBindBuffer(GL_ARRAY_BUFFER, buffer);
+        for (const GlbAttribute &attribute: primitive.attributes)
+        {
+            glEnableVertexAttribArray(attribute.location);
+            glVertexAttribPointer(attribute.location, attribute.components, attribute.type, attribute.normalized, attribute.stride,
+                                  (void*)attribute.offset);
+        }
+        if (primitive.indexed)
+            glBindBuffer(GL_ELEMENT_ARRAY_BUFFER, buffer);
+        glBindVertexArray(0);
+        GeometryArena::InvalidateBinding();
+        return vao;
+    }
+
+private:
+    static bool bufferView(const JsonValue &gltf, int index, size_t &offset, size_t &size)
+    {
+        const JsonValue &view = gltf["bufferViews"][(size_t)index];
+        if (view.type != JsonValue::Object || view["buffer"].AsInt() != 0)
+            return false;
+        offset = view["byteOffset"].AsNumber();
+        size = view["byteLength"].AsNumber();
+        return true;
+    }
+
+    static int componentCount(const std::string &type)
+    {
+        if (type == "SCALAR") return 1;
+        if (type == "VEC2") return 2;
+        if (type == "VEC3") return 3;
+        if (type == "VEC4") return 4;
+        return 0;
+    }
+
+    static size_t componentSize(GLenum type)
+    {
+        return type == GL_BYTE || type == GL_UNSIGNED_BYTE ? 1 : type == GL_SHORT || type == GL_UNSIGNED_SHORT ? 2 : 4;
+    }
+
+    // resolves an accessor to an offset into the binary chunk, checking it stays inside its buffer view
+    static bool accessor(const JsonValue &gltf, const GlbAsset &asset, int index, size_t &offset, GLint &components,
+                         GLenum &type, GLsizei &stride, size_t &count, const JsonValue *&description)
+    {
+        const JsonValue &value = gltf["accessors"][(size_t)index];
+        description = &value;
+        size_t viewOffset, viewSize;
+        if (value.type != JsonValue::Object || value.Has("sparse") || !value.Has("bufferView") ||
+            !bufferView(gltf, value["bufferView"].AsInt(), viewOffset, viewSize))
+            return false;
+        components = componentCount(value["type"].AsString());
+        type = value["componentType"].AsInt();
+        count = value["count"].AsNumber();
+        stride = gltf["bufferViews"][(size_t)value["bufferView"].AsInt()]["byteStride"].AsInt();
+        size_t elementSize = components * componentSize(type);
+        offset = viewOffset + (size_t)value["byteOffset"].AsNumber();
+        size_t span = count ? (count - 1) * (stride ? stride : elementSize) + elementSize : 0;
+        return components > 0 && offset + span <= viewOffset + viewSize && viewOffset + viewSize <= asset.binarySize;
+    }
+
+    static bool loadPrimitive(const JsonValue &gltf, const JsonValue &value, const GlbAsset &asset, const std::string &name,
+                              GlbPrimitive &primitive)
+    {
+        static const std::pair<const char *, GLuint> locations[] = {{"POSITION", 0}, {"NORMAL", 1}, {"TEXCOORD_0", 2}, {"TANGENT", 3}};
+        primitive.mode = value["mode"].AsInt(GL_TRIANGLES);
+        const JsonValue &attributes = value["attributes"];
+        size_t vertexCount = 0;
+        for (const auto &location: locations)
+        {
+            if (!attributes.Has(location.first))
+                continue;
+            GlbAttribute attribute;
+            size_t count;
+            const JsonValue *description;
+            if (!accessor(gltf, asset, attributes[location.first].AsInt(), attribute.offset, attribute.components, attribute.type,
+                          attribute.stride, count, description))
+                return false;
+            attribute.location = location.second;
+            attribute.normalized = (*description)["normalized"].type == JsonValue::Bool && (*description)["normalized"].boolean;
+            primitive.attributes.push_back(attribute);
+            if (location.second == 0)
+            {
+                vertexCount = count;
+                // glTF requires bounds on positions
+                const JsonValue &minimum = (*description)["min"], &maximum = (*description)["max"];
+                for (int k = 0; k < 3; k++)
+                {
+                    primitive.boundsMin[k] = minimum[(size_t)k].AsNumber();
+                    primitive.boundsMax[k] = maximum[(size_t)k].AsNumber();
+                }
+            }
+        }
+        if (primitive.attributes.empty() || primitive.attributes[0].location != 0)
+            return false;
+
+        primitive.count = vertexCount;
+        if (value.Has("indices"))
+        {
+            GLint components;
+            GLsizei stride;
+            size_t count;
+            const JsonValue *description;
+            if (!accessor(gltf, asset, value["indices"].AsInt(), primitive.indexOffset, components, primitive.indexType, stride,
+                          count, description) || components != 1)
+                return false;
+            primitive.indexed = true;
+            primitive.count = count;
+        }
+
+        // material textures, typed like the ones Model::processMesh assigns
+        const JsonValue &material = gltf["materials"][(size_t)value["material"].AsInt(-1)];
+        const JsonValue &pbr = material["pbrMetallicRoughness"];
+        addTexture(gltf, pbr["baseColorTexture"], "texture_diffuse", name, primitive.textures);
+        addTexture(gltf, pbr["metallicRoughnessTexture"], "texture_specular", name, primitive.textures);
+        addTexture(gltf, material["normalTexture"], "texture_normal", name, primitive.textures);
+        return true;
+    }
+
+    // embedded images are named after the file and their index, see GlbAsset::images; external ones by their URI
+    static void addTexture(const JsonValue &gltf, const JsonValue &info, const char *type, const std::string &name,
+                           std::vector<Texture> &textures)
+    {
+        if (!info.Has("index"))
+            return;
+        int source = gltf["textures"][(size_t)info["index"].AsInt()]["source"].AsInt(-1);
+        const JsonValue &image = gltf["images"][(size_t)source];
+        Texture texture;
+        texture.id = 0;
+        texture.type = type;
+        if (image.Has("bufferView"))
+            texture.path = name + "#image" + std::to_string(source);
+        else if (image.Has("uri") && image["uri"].AsString().compare(0, 5, "data:") != 0)
+            texture.path = image["uri"].AsString();
+        else
+            return;
+        textures.push_back(texture);
+    }
+};
+#endif
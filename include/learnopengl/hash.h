@@ -0,0 +1,57 @@
+#ifndef HASH_H
+#define HASH_H
+
+#include <cstddef>
+#include <cstdint>
+#include <string>
+
+// 64-bit FNV-1a, used to key on-disk caches and lookup tables.
+// The string overload is constexpr so that hashes of literals can be folded at compile time.
+const uint64_t FNV_OFFSET_BASIS = 14695981039346656037ull;
+const uint64_t FNV_PRIME        = 1099511628211ull;
+
+constexpr uint64_t fnv1a(const char *str, uint64_t hash = FNV_OFFSET_BASIS)
+{
+    while (*str)
+    {
+        hash ^= (unsigned char)*str++;
+        hash *= FNV_PRIME;
+    }
+    return hash;
+}
+
+inline uint64_t fnv1a(const void *data, size_t size, uint64_t hash = FNV_OFFSET_BASIS)
+{
+    const unsigned char *bytes = (const unsigned char *)data;
+    for (size_t i = 0; i < size; i++)
+    {
+        hash ^= bytes[i];
+        hash *= FNV_PRIME;
+    }
+    return hash;
+}
+
+inline uint64_t fnv1a(const std::string &str, uint64_t hash = FNV_OFFSET_BASIS)
+{
+    return fnv1a(str.data(), str.size(), hash);
+}
+
+// mixes a plain value (flags, versions, sizes) into a running hash
+template <typename T>
+inline uint64_t fnv1aValue(const T &value, uint64_t hash)
+{
+    return fnv1a(&value, sizeof(T), hash);
+}
+
+inline std::string hashToHex(uint64_t hash)
+{
+    static const char digits[] = "0123456789abcdef";
+    std::string hex(16, '0');
+    for (int i = 15; i >= 0; i--)
+    {
+        hex[i] = digits[hash & 0xF];
+        hash >>= 4;
+    }
+    return hex;
+}
+#endif
@@ -0,0 +1,218 @@
+#ifndef JSON_H
+#define JSON_H
+
+#include <cstdlib>
+#include <cstring>
+#include <string>
+#include <utility>
+#include <vector>
+
+// Minimal read-only JSON document, enough for glTF headers: values are parsed into a tree once and looked up
+// by key or index. Missing keys and out of range indices yield a null value, so lookups can be chained.
+class JsonValue
+{
+public:
+    enum Type { Null, Bool, Number, String, Array, Object };
+
+    Type type = Null;
+    bool boolean = false;
+    double number = 0.0;
+    std::string string;
+    std::vector<JsonValue> array;
+    std::vector<std::pair<std::string, JsonValue>> object;
+
+    static bool Parse(const char *begin, const char *end, JsonValue &value)
+    {
+        const char *s = parseValue(skip(begin, end), end, value, 0);
+        return s && skip(s, end) == end;
+    }
+
+    const JsonValue &operator[](const char *key) const
+    {
+        for (const auto &member: object)
+            if (member.first == key)
+                return member.second;
+        return null();
+    }
+
+    const JsonValue &operator[](size_t index) const
+    {
+        return index < array.size() ? array[index] : null();
+    }
+
+    bool Has(const char *key) const
+    {
+        return &(*this)[key] != &null();
+    }
+
+    size_t Size() const
+    {
+        return type == Array ? array.size() : object.size();
+    }
+
+    double AsNumber(double fallback = 0.0) const
+    {
+        return type == Number ? number : fallback;
+    }
+
+    int AsInt(int fallback = 0) const
+    {
+        return type == Number ? (int)number : fallback;
+    }
+
+    const std::string &AsString() const
+    {
+        return string;
+    }
+
+private:
+    static const JsonValue &null()
+    {
+        static const JsonValue value;
+        return value;
+    }
+
+    static const char *skip(const char *s, const char *end)
+    {
+        while (s < end && (*s == ' ' || *s == '\t' || *s == '\n' || *s == '\r'))
+            s++;
+        return s;
+    }
+
+    static const char *parseValue(const char *s, const char *end, JsonValue &value, int depth)
+    {
+        if (s >= end || depth > 64)
+            return nullptr;
+        switch (*s)
+        {
+        case '{':
+        {
+            value.type = Object;
+            s = skip(s + 1, end);
+            if (s < end && *s == '}')
+                return s + 1;
+            while (s < end)
+            {
+                std::string key;
+                s = parseString(s, end, key);
+                if (!s || (s = skip(s, end)) >= end || *s != ':')
+                    return nullptr;
+                value.object.push_back(std::make_pair(key, JsonValue()));
+                s = parseValue(skip(s + 1, end), end, value.object.back().second, depth + 1);
+                if (!s || (s = skip(s, end)) >= end)
+                    return nullptr;
+                if (*s == '}')
+                    return s + 1;
+                if (*s != ',')
+                    return nullptr;
+                s = skip(s + 1, end);
+            }
+            return nullptr;
+        }
+        case '[':
+        {
+            value.type = Array;
+            s = skip(s + 1, end);
+            if (s < end && *s == ']')
+                return s + 1;
+            while (s < end)
+            {
+                value.array.push_back(JsonValue());
+                s = parseValue(s, end, value.array.back(), depth + 1);
+                if (!s || (s = skip(s, end)) >= end)
+                    return nullptr;
+                if (*s == ']')
+                    return s + 1;
+                if (*s != ',')
+                    return nullptr;
+                s = skip(s + 1, end);
+            }
+            return nullptr;
+        }
+        case '"':
+            value.type = String;
+            return parseString(s, end, value.string);
+        case 't':
+            value.type = Bool;
+            value.boolean = true;
+            return literal(s, end, "true");
+        case 'f':
+            value.type = Bool;
+            return literal(s, end, "false");
+        case 'n':
+            return literal(s, end, "null");
+        default:
+        {
+            // strtod needs a terminated string, numbers are short
+            char buffer[64];
+            size_t length = 0;
+            while (s + length < end && length < sizeof(buffer) - 1 && strchr("+-0123456789.eE", s[length]))
+                length++;
+            if (length == 0)
+                return nullptr;
+            memcpy(buffer, s, length);
+            buffer[length] = '\0';
+            value.type = Number;
+            value.number = strtod(buffer, nullptr);
+            return s + length;
+        }
+        }
+    }
+
+    static const char *literal(const char *s, const char *end, const char *word)
+    {
+        size_t length = strlen(word);
+        return (size_t)(end - s) >= length && strncmp(s, word, length) == 0 ? s + length : nullptr;
+    }
+
+    // escapes are decoded to UTF-8, which is all glTF keys and URIs need
+    static const char *parseString(const char *s, const char *end, std::string &out)
+    {
+        if (s >= end || *s != '"')
+            return nullptr;
+        for (s++; s < end; s++)
+        {
+            if (*s == '"')
+                return s + 1;
+            if (*s != '\\')
+            {
+                out += *s;
+                continue;
+            }
+            if (++s >= end)
+                return nullptr;
+            switch (*s)
+            {
+            case 'n': out += '\n'; break;
+            case 't': out += '\t'; break;
+            case 'r': out += '\r'; break;
+            case 'b': out += '\b'; break;
+            case 'f': out += '\f'; break;
+            case 'u':
+            {
+                if (end - s < 5)
+                    return nullptr;
+                unsigned int code = strtoul(std::string(s + 1, s + 5).c_str(), nullptr, 16);
+                s += 4;
+                if (code < 0x80)
+                    out += (char)code;
+                else if (code < 0x800)
+                {
+                    out += (char)(0xC0 | (code >> 6));
+                    out += (char)(0x80 | (code & 0x3F));
+                }
+                else
+                {
+                    out += (char)(0xE0 | (code >> 12));
+                    out += (char)(0x80 | ((code >> 6) & 0x3F));
+                    out += (char)(0x80 | (code & 0x3F));
+                }
+                break;
+            }
+            default: out += *s; break;
+            }
+        }
+        return nullptr;
+    }
+};
+#endif
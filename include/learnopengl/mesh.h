@@ -6,33 +6,119 @@
 #include <glm/glm.hpp>
 #include <glm/gtc/matrix_transform.hpp>
 
+#include <learnopengl/geometry_arena.h>
+#include <learnopengl/gl_state.h>
 #include <learnopengl/shader.h>
+#include <learnopengl/vertex_format.h>
 
+#include <algorithm>
+#include <cmath>
+#include <cstdint>
 #include <string>
+#include <type_traits>
 #include <vector>
 using namespace std;
 
-struct Vertex {
-    // position
-    glm::vec3 Position;
-    // normal
-    glm::vec3 Normal;
-    // texCoords
-    glm::vec2 TexCoords;
-    // tangent
-    glm::vec3 Tangent;
-    // bitangent
-    glm::vec3 Bitangent;
-};
-
-
-
 struct Texture {
     unsigned int id;
     string type;
     string path;
 };
 
+// levels of detail per mesh, LOD 0 included
+const int MAX_MESH_LODS = 4;
+
+// one level of detail: a range of the mesh's index buffer drawn against the shared vertices
+struct MeshLod {
+    uint32_t indexOffset;
+    uint32_t indexCount;
+    float    error; // object-space deviation from LOD 0
+};
+
+// a run of LOD 0 triangles culled as a unit, see MeshClusterizer
+struct MeshCluster {
+    uint32_t  indexOffset;
+    uint32_t  indexCount;
+    glm::vec3 center;     // bounding sphere, object space
+    float     radius;
+    glm::vec3 coneAxis;   // average facing of the triangles
+    float     coneCutoff; // sine of the cone's half angle, 1 if the triangles face too many ways to ever cull
+};
+
+struct MeshClusterStats {
+    size_t tested = 0;
+    size_t accepted = 0;
+    size_t trianglesTested = 0;
+    size_t trianglesAccepted = 0;
+
+    void Reset()
+    {
+        *this = MeshClusterStats();
+    }
+};
+
+// the camera as seen from one object's space: frustum planes and eye position, for culling that object's clusters.
+// assumes the model matrix scales uniformly.
+struct ClusterView {
+    glm::vec4 planes[6];
+    glm::vec3 eye;
+
+    static ClusterView FromTransforms(const glm::mat4 &model, const glm::mat4 &view, const glm::mat4 &projection)
+    {
+        ClusterView clusterView;
+        glm::mat4 m = projection * view * model;
+        glm::vec4 rows[4];
+        for (int i = 0; i < 4; i++)
+            rows[i] = glm::vec4(m[0][i], m[1][i], m[2][i], m[3][i]);
+        for (int i = 0; i < 3; i++)
+        {
+            clusterView.planes[2 * i] = rows[3] + rows[i];
+            clusterView.planes[2 * i + 1] = rows[3] - rows[i];
+        }
+        for (glm::vec4 &plane: clusterView.planes)
+            plane /= glm::length(glm::vec3(plane));
+        clusterView.eye = glm::vec3(glm::inverse(view * model)[3]);
+        return clusterView;
+    }
+
+    // false if the cluster is outside the frustum or all its triangles face away from the eye
+    bool Visible(const MeshCluster &cluster) const
+    {
+        for (const glm::vec4 &plane: planes)
+            if (glm::dot(glm::vec3(plane), cluster.center) + plane.w < -cluster.radius)
+                return false;
+        glm::vec3 toCenter = cluster.center - eye;
+        return glm::dot(toCenter, cluster.coneAxis) < cluster.coneCutoff * glm::length(toCenter) + cluster.radius;
+    }
+};
+
+// CPU side result of importing a mesh, before anything is uploaded to the GPU.
+// textures only carry their type and path here, the ids are filled in once the model loads them.
+// indices holds every LOD back to back, see lods; without lods all indices are a single level.
+struct MeshData {
+    vector<Vertex>       vertices;
+    vector<unsigned int> indices;
+    vector<Texture>      textures;
+    vector<MeshLod>      lods;
+    vector<MeshCluster>  clusters; // partition of LOD 0, empty if the mesh wasn't clustered
+};
+
+// geometry in a VAO and buffer of its own rather than in a GeometryArena, e.g. a glTF primitive (see GlbLoader)
+struct MeshVertexArray {
+    GLuint vao = 0;
+    GLenum mode = GL_TRIANGLES;
+    bool indexed = false;
+    GLenum indexType = GL_UNSIGNED_INT;
+    size_t indexOffset = 0;
+};
+
+// what a mesh keeps of its geometry in RAM once it is on the GPU
+enum class CpuGeometry {
+    Keep,          // full vertices and all indices
+    PositionsOnly, // positions and LOD 0 indices, enough for picking and collision
+    Release        // nothing
+};
+
 class Mesh {
 public:
     // mesh Data
@@ -40,21 +126,56 @@ public:
     vector<unsigned int> indices;
     vector<Texture>      textures;
 
-    unsigned int VAO;
     std::string glslIdentifierPrefix;
-    // constructor
-    Mesh(vector<Vertex> vertices, vector<unsigned int> indices, vector<Texture> textures)
+    VertexFormat format;
+    PositionDequantization dequantization;
+    GeometryArena::Handle geometry; // range in the shared arena of `format`
+    MeshVertexArray vertexArray;    // used instead of the arena when its vao is set
+    vector<MeshLod> lods;
+    vector<MeshCluster> clusters;
+    vector<glm::vec3> positions;    // filled by ReleaseCpuGeometry(PositionsOnly)
+    int lod = 0;                    // level drawn by Draw, picked by Model::Draw
+    glm::vec3 boundsCenter;         // object-space bounding sphere
+    float boundsRadius;
+    // constructor, takes over the vectors passed in; pass them with std::move to avoid copying the geometry
+    Mesh(vector<Vertex> vertices, vector<unsigned int> indices, vector<Texture> textures, VertexFormat format = VertexFormat::Full,
+         vector<MeshLod> lods = vector<MeshLod>(), vector<MeshCluster> clusters = vector<MeshCluster>())
     {
-        this->vertices = vertices;
-        this->indices = indices;
-        this->textures = textures;
+        this->vertices = std::move(vertices);
+        this->indices = std::move(indices);
+        this->textures = std::move(textures);
+        this->format = format;
+        this->lods = std::move(lods);
+        this->clusters = std::move(clusters);
+        if (this->lods.empty())
+            this->lods.push_back(MeshLod{0, (uint32_t)this->indices.size(), 0.0f});
+        computeBounds();
 
         // now that we have all the required data, set the vertex buffers and its attribute pointers.
         setupMesh();
     }
 
-    // render the mesh
-    void Draw(Shader &shader)
+    // a mesh drawn from a vertex array set up elsewhere, with `count` indices (or vertices when not indexed).
+    // the mesh takes over the VAO, the buffer behind it stays with the caller.
+    Mesh(MeshVertexArray vertexArray, GLsizei count, vector<Texture> textures, glm::vec3 boundsMin, glm::vec3 boundsMax)
+    {
+        this->vertexArray = vertexArray;
+        this->textures = std::move(textures);
+        format = VertexFormat::Full;
+        geometry = GeometryArena::INVALID_HANDLE;
+        lods.push_back(MeshLod{0, (uint32_t)count, 0.0f});
+        boundsCenter = (boundsMin + boundsMax) * 0.5f;
+        boundsRadius = glm::length(boundsMax - boundsMin) * 0.5f;
+    }
+
+    // a mesh owns its arena range, so it can be moved but not copied
+    Mesh(const Mesh &) = delete;
+    Mesh &operator=(const Mesh &) = delete;
+    Mesh(Mesh &&) = default;
+    Mesh &operator=(Mesh &&) = default;
+
+    // render the mesh. given a view, LOD 0 is drawn cluster by cluster, skipping the clusters the view can't see.
+    void Draw(Shader &shader, const ClusterView *view = nullptr)
     {
         // bind appropriate textures
         unsigned int diffuseNr  = 1;
@@ -63,77 +184,212 @@ public:
         unsigned int heightNr   = 1;
         for(unsigned int i = 0; i < textures.size(); i++)
         {
-            glActiveTexture(GL_TEXTURE0 + i); // active proper texture unit before binding
-            // retrieve texture number (the N in diffuse_textureN)
-            string number;
-            string name = textures[i].type;
+            // retrieve texture number (the N in diffuse_textureN); the sampler's name is hashed piecewise, not built
+            const string &name = textures[i].type;
+            UniformName sampler = UniformName(glslIdentifierPrefix).Append(name);
             if(name == "texture_diffuse")
-                number = std::to_string(diffuseNr++);
+                sampler = sampler.Append(diffuseNr++);
             else if(name == "texture_specular")
-                number = std::to_string(specularNr++); // transfer unsigned int to stream
+                sampler = sampler.Append(specularNr++);
             else if(name == "texture_normal")
-                number = std::to_string(normalNr++); // transfer unsigned int to stream
+                sampler = sampler.Append(normalNr++);
             else if(name == "texture_height")
-                number = std::to_string(heightNr++); // transfer unsigned int to stream
+                sampler = sampler.Append(heightNr++);
 
             // now set the sampler to the correct texture unit
-            glUniform1i(glGetUniformLocation(shader.ID, (glslIdentifierPrefix + name + number).c_str()), i);
+            shader.setInt(sampler, i);
             // and finally bind the texture
-            glBindTexture(GL_TEXTURE_2D, textures[i].id);
+            GLState::BindTexture(i, GL_TEXTURE_2D, textures[i].id);
         }
 
 
 
+        // undo position quantization (identity for unquantized formats)
+        shader.setVec3("positionScale", dequantization.scale);
+        shader.setVec3("positionOffset", dequantization.offset);
+
         // draw mesh
-        glBindVertexArray(VAO);
-        glDrawElements(GL_TRIANGLES, indices.size(), GL_UNSIGNED_INT, 0);
-        glBindVertexArray(0);
+        if (vertexArray.vao)
+        {
+            GLState::BindVertexArray(vertexArray.vao);
+            if (vertexArray.indexed)
+                glDrawElements(vertexArray.mode, lods[0].indexCount, vertexArray.indexType, (void*)vertexArray.indexOffset);
+            else
+                glDrawArrays(vertexArray.mode, 0, lods[0].indexCount);
+        }
+        else if (view && lod == 0 && !clusters.empty() && ClusterCulling())
+            drawClusters(*view);
+        else
+            GeometryArena::For(format).DrawRange(geometry, lods[lod].indexOffset, lods[lod].indexCount);
+    }
+
+    // gives the mesh's range back to the geometry arena, the mesh can't be drawn afterwards
+    void Release()
+    {
+        if (geometry != GeometryArena::INVALID_HANDLE)
+            GeometryArena::For(format).Free(geometry);
+        geometry = GeometryArena::INVALID_HANDLE;
+        if (vertexArray.vao)
+        {
+            glDeleteVertexArrays(1, &vertexArray.vao);
+            GLState::VertexArrayDeleted(vertexArray.vao);
+        }
+        vertexArray.vao = 0;
+    }
+
+    // drops the CPU copies of the geometry that `policy` doesn't keep, the GPU copy is unaffected
+    void ReleaseCpuGeometry(CpuGeometry policy)
+    {
+        if (policy == CpuGeometry::Keep)
+            return;
+        vector<glm::vec3>().swap(positions);
+        if (policy == CpuGeometry::PositionsOnly)
+        {
+            positions.reserve(vertices.size());
+            for (const Vertex &vertex: vertices)
+                positions.push_back(vertex.Position);
+            indices.resize(lods[0].indexCount);
+            indices.shrink_to_fit();
+        }
+        else
+            vector<unsigned int>().swap(indices);
+        vector<Vertex>().swap(vertices);
+    }
+
+    // RAM held by the mesh's geometry and tables
+    size_t CpuBytes() const
+    {
+        return vertices.capacity() * sizeof(Vertex) + indices.capacity() * sizeof(unsigned int) +
+               positions.capacity() * sizeof(glm::vec3) + lods.capacity() * sizeof(MeshLod) +
+               clusters.capacity() * sizeof(MeshCluster) + textures.capacity() * sizeof(Texture);
+    }
+
+    static bool &ClusterCulling()
+    {
+        static bool enabled = true;
+        return enabled;
+    }
 
-        // always good practice to set everything back to defaults once configured.
-        glActiveTexture(GL_TEXTURE0);
+    static MeshClusterStats &ClusterStats()
+    {
+        static MeshClusterStats stats;
+        return stats;
     }
 
 private:
-    // render data
-    unsigned int VBO, EBO;
+    // the visible clusters go out as one multi-draw, neighbours in the index buffer merged into one range
+    void drawClusters(const ClusterView &view)
+    {
+        static vector<GLsizei> counts;
+        static vector<size_t> firstIndices;
+        counts.clear();
+        firstIndices.clear();
+        MeshClusterStats &stats = ClusterStats();
+        for (const MeshCluster &cluster: clusters)
+        {
+            stats.tested++;
+            stats.trianglesTested += cluster.indexCount / 3;
+            if (!view.Visible(cluster))
+                continue;
+            stats.accepted++;
+            stats.trianglesAccepted += cluster.indexCount / 3;
+            if (!counts.empty() && firstIndices.back() + counts.back() == cluster.indexOffset)
+                counts.back() += cluster.indexCount;
+            else
+            {
+                counts.push_back(cluster.indexCount);
+                firstIndices.push_back(cluster.indexOffset);
+            }
+        }
+        if (!counts.empty())
+            GeometryArena::For(format).DrawRanges(geometry, counts, firstIndices);
+    }
+
+    void computeBounds()
+    {
+        glm::vec3 minimum(0.0f), maximum(0.0f);
+        if (!vertices.empty())
+            minimum = maximum = vertices[0].Position;
+        for (const Vertex &vertex: vertices)
+        {
+            minimum = glm::min(minimum, vertex.Position);
+            maximum = glm::max(maximum, vertex.Position);
+        }
+        boundsCenter = (minimum + maximum) * 0.5f;
+        boundsRadius = 0.0f;
+        for (const Vertex &vertex: vertices)
+            boundsRadius = std::max(boundsRadius, glm::length(vertex.Position - boundsCenter));
+    }
 
-    // initializes all the buffer objects/arrays
+    // uploads the vertices in the mesh's format and the indices into the shared geometry arena
     void setupMesh()
     {
-        // create buffers/arrays
-        glGenVertexArrays(1, &VAO);
-        glGenBuffers(1, &VBO);
-        glGenBuffers(1, &EBO);
-
-        glBindVertexArray(VAO);
-        // load data into vertex buffers
-        glBindBuffer(GL_ARRAY_BUFFER, VBO);
-        // A great thing about structs is that their memory layout is sequential for all its items.
-        // The effect is that we can simply pass a pointer to the struct and it translates perfectly to a glm::vec3/2 array which
-        // again translates to 3/2 floats which translates to a byte array.
-        glBufferData(GL_ARRAY_BUFFER, vertices.size() * sizeof(Vertex), &vertices[0], GL_STATIC_DRAW);
-
-        glBindBuffer(GL_ELEMENT_ARRAY_BUFFER, EBO);
-        glBufferData(GL_ELEMENT_ARRAY_BUFFER, indices.size() * sizeof(unsigned int), &indices[0], GL_STATIC_DRAW);
-
-        // set the vertex attribute pointers
-        // vertex Positions
-        glEnableVertexAttribArray(0);
-        glVertexAttribPointer(0, 3, GL_FLOAT, GL_FALSE, sizeof(Vertex), (void*)0);
-        // vertex normals
-        glEnableVertexAttribArray(1);
-        glVertexAttribPointer(1, 3, GL_FLOAT, GL_FALSE, sizeof(Vertex), (void*)offsetof(Vertex, Normal));
-        // vertex texture coords
-        glEnableVertexAttribArray(2);
-        glVertexAttribPointer(2, 2, GL_FLOAT, GL_FALSE, sizeof(Vertex), (void*)offsetof(Vertex, TexCoords));
-        // vertex tangent
-        glEnableVertexAttribArray(3);
-        glVertexAttribPointer(3, 3, GL_FLOAT, GL_FALSE, sizeof(Vertex), (void*)offsetof(Vertex, Tangent));
-        // vertex bitangent
-        glEnableVertexAttribArray(4);
-        glVertexAttribPointer(4, 3, GL_FLOAT, GL_FALSE, sizeof(Vertex), (void*)offsetof(Vertex, Bitangent));
-
-        glBindVertexArray(0);
+        GeometryArena &arena = GeometryArena::For(format);
+        if (format == VertexFormat::Packed)
+        {
+            vector<PackedVertex> packed = packVertices<PackedVertex>();
+            geometry = arena.Allocate(packed.data(), packed.size(), indices);
+        }
+        else if (format == VertexFormat::PackedQuantized)
+        {
+            vector<QuantizedVertex> packed = packVertices<QuantizedVertex>();
+            geometry = arena.Allocate(packed.data(), packed.size(), indices);
+        }
+        else
+        {
+            // A great thing about structs is that their memory layout is sequential for all its items.
+            // The effect is that we can simply pass a pointer to the struct and it translates perfectly to a glm::vec3/2 array which
+            // again translates to 3/2 floats which translates to a byte array.
+            geometry = arena.Allocate(vertices.data(), vertices.size(), indices);
+        }
+    }
+
+private:
+    // converts the CPU vertices into one of the packed layouts, filling in the dequantization for quantized positions
+    template <typename PackedType>
+    vector<PackedType> packVertices()
+    {
+        glm::vec3 minimum(0.0f), extent(1.0f);
+        if (is_same<PackedType, QuantizedVertex>::value && !vertices.empty())
+        {
+            glm::vec3 maximum = vertices[0].Position;
+            minimum = vertices[0].Position;
+            for (const Vertex& vertex: vertices)
+            {
+                minimum = glm::min(minimum, vertex.Position);
+                maximum = glm::max(maximum, vertex.Position);
+            }
+            extent = glm::max(maximum - minimum, glm::vec3(1e-6f));
+            dequantization.scale = extent;
+            dequantization.offset = minimum;
+        }
+
+        vector<PackedType> packed(vertices.size());
+        for (size_t i = 0; i < vertices.size(); i++)
+        {
+            const Vertex& vertex = vertices[i];
+            PackedType& out = packed[i];
+            packPosition(vertex.Position, minimum, extent, out);
+            out.Normal = VertexPacking::PackSnorm1010102(vertex.Normal);
+            out.Tangent = VertexPacking::PackSnorm1010102(vertex.Tangent, VertexPacking::BitangentSign(vertex.Normal, vertex.Tangent, vertex.Bitangent));
+            out.TexCoords[0] = VertexPacking::PackHalf(vertex.TexCoords.x);
+            out.TexCoords[1] = VertexPacking::PackHalf(vertex.TexCoords.y);
+        }
+        return packed;
+    }
+
+    static void packPosition(const glm::vec3& position, const glm::vec3&, const glm::vec3&, PackedVertex& out)
+    {
+        out.Position[0] = position.x;
+        out.Position[1] = position.y;
+        out.Position[2] = position.z;
+    }
+
+    static void packPosition(const glm::vec3& position, const glm::vec3& minimum, const glm::vec3& extent, QuantizedVertex& out)
+    {
+        for (int c = 0; c < 3; c++)
+            out.Position[c] = (uint16_t)lround(glm::clamp((position[c] - minimum[c]) / extent[c], 0.0f, 1.0f) * 65535.0f);
+        out.Position[3] = 0;
     }
 };
 #endif
\ No newline at end of file
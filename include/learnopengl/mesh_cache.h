@@ -0,0 +1,235 @@
+#ifndef MESH_CACHE_H
+#define MESH_CACHE_H
+
+#include <learnopengl/asset_cache.h>
+#include <learnopengl/mesh.h>
+#include <learnopengl/obj_loader.h>
+
+#include <algorithm>
+#include <cctype>
+#include <cstring>
+#include <string>
+#include <vector>
+
+// Baked copy of a model's final vertex/index/material tables, so a warm start can skip the importer.
+// The file is used through a read-only mapping: header, mesh table, texture table, then 16-byte aligned
+// vertex, index and cluster blobs that are copied straight into the mesh vectors, and finally the string table.
+// Bump MESH_CACHE_VERSION whenever the layout or the import pipeline output changes.
+const uint32_t MESH_CACHE_VERSION = 7;
+
+struct MeshCacheHeader {
+    char     magic[8];
+    uint32_t version;
+    uint32_t vertexSize;
+    uint64_t key;
+    uint32_t meshCount;
+    uint32_t textureCount;
+    uint64_t stringsOffset;
+    uint64_t stringsSize;
+};
+
+struct MeshCacheEntry {
+    uint64_t verticesOffset;
+    uint64_t indicesOffset;
+    uint64_t clustersOffset;
+    uint32_t vertexCount;
+    uint32_t indexCount;
+    uint32_t firstTexture;
+    uint32_t textureCount;
+    uint32_t lodCount;
+    MeshLod  lods[MAX_MESH_LODS];
+    uint32_t clusterCount;
+};
+
+struct MeshCacheTexture {
+    uint32_t typeOffset;
+    uint32_t typeLength;
+    uint32_t pathOffset;
+    uint32_t pathLength;
+};
+
+class MeshCache
+{
+public:
+    static std::string PathFor(const std::string &modelPath)
+    {
+        return modelPath + ".meshcache";
+    }
+
+    // key over the source file contents, the .mtl files an OBJ takes its materials from, and everything that
+    // changes what the import produces. returns 0 when the source can't be read, in which case the cache is not used.
+    static uint64_t Key(const std::string &modelPath, unsigned int importFlags)
+    {
+        uint64_t key = AssetCache::HashFile(modelPath);
+        if (key == 0)
+            return 0;
+        std::string extension = modelPath.substr(modelPath.find_last_of('.') + 1);
+        std::transform(extension.begin(), extension.end(), extension.begin(), ::tolower);
+        if (extension == "obj")
+            for (const std::string &library: ObjLoader::MaterialLibraries(modelPath))
+                key = fnv1aValue(AssetCache::HashFile(library), key);
+        key = fnv1aValue(importFlags, key);
+        key = fnv1aValue(MESH_CACHE_VERSION, key);
+        key = fnv1aValue((uint32_t)sizeof(Vertex), key);
+        return key;
+    }
+
+    // true if the cache file exists and was baked from the current source and pipeline; only reads the header
+    static bool IsCurrent(const std::string &cachePath, uint64_t key)
+    {
+        MappedFile file(cachePath);
+        if (key == 0 || !file.valid() || file.length() < sizeof(MeshCacheHeader))
+            return false;
+        MeshCacheHeader header;
+        memcpy(&header, file.bytes(), sizeof(header));
+        return memcmp(header.magic, magic(), sizeof(header.magic)) == 0 && header.version == MESH_CACHE_VERSION &&
+               header.vertexSize == sizeof(Vertex) && header.key == key;
+    }
+
+    static bool Load(const std::string &cachePath, uint64_t key, std::vector<MeshData> &meshes)
+    {
+        MappedFile file(cachePath);
+        if (!file.valid() || file.length() < sizeof(MeshCacheHeader))
+            return false;
+
+        const unsigned char *base = file.bytes();
+        MeshCacheHeader header;
+        memcpy(&header, base, sizeof(header));
+        if (memcmp(header.magic, magic(), sizeof(header.magic)) != 0 || header.version != MESH_CACHE_VERSION ||
+            header.vertexSize != sizeof(Vertex) || header.key != key)
+            return false;
+
+        size_t tablesEnd = sizeof(MeshCacheHeader) + header.meshCount * sizeof(MeshCacheEntry) +
+                           header.textureCount * sizeof(MeshCacheTexture);
+        if (tablesEnd > file.length() || header.stringsOffset + header.stringsSize > file.length())
+            return false;
+
+        const MeshCacheEntry *entries = (const MeshCacheEntry *)(base + sizeof(MeshCacheHeader));
+        const MeshCacheTexture *textures = (const MeshCacheTexture *)(entries + header.meshCount);
+        const char *strings = (const char *)(base + header.stringsOffset);
+
+        std::vector<MeshData> loaded(header.meshCount);
+        for (uint32_t i = 0; i < header.meshCount; i++)
+        {
+            const MeshCacheEntry &entry = entries[i];
+            if (entry.verticesOffset + (uint64_t)entry.vertexCount * sizeof(Vertex) > file.length() ||
+                entry.indicesOffset + (uint64_t)entry.indexCount * sizeof(unsigned int) > file.length() ||
+                entry.clustersOffset + (uint64_t)entry.clusterCount * sizeof(MeshCluster) > file.length() ||
+                entry.firstTexture + entry.textureCount > header.textureCount)
+                return false;
+
+            const Vertex *vertices = (const Vertex *)(base + entry.verticesOffset);
+            const unsigned int *indices = (const unsigned int *)(base + entry.indicesOffset);
+            loaded[i].vertices.assign(vertices, vertices + entry.vertexCount);
+            loaded[i].indices.assign(indices, indices + entry.indexCount);
+            if (entry.lodCount > MAX_MESH_LODS)
+                return false;
+            // LODs are drawn straight from their ranges, a stale or corrupt entry must not reach past the indices
+            for (uint32_t l = 0; l < entry.lodCount; l++)
+                if ((uint64_t)entry.lods[l].indexOffset + entry.lods[l].indexCount > entry.indexCount)
+                    return false;
+            loaded[i].lods.assign(entry.lods, entry.lods + entry.lodCount);
+            const MeshCluster *clusters = (const MeshCluster *)(base + entry.clustersOffset);
+            // clusters are runs of LOD 0 triangles
+            uint64_t lod0End = entry.lodCount ? (uint64_t)entry.lods[0].indexOffset + entry.lods[0].indexCount : entry.indexCount;
+            for (uint32_t c = 0; c < entry.clusterCount; c++)
+                if ((uint64_t)clusters[c].indexOffset + clusters[c].indexCount > lod0End)
+                    return false;
+            loaded[i].clusters.assign(clusters, clusters + entry.clusterCount);
+            for (uint32_t t = entry.firstTexture; t < entry.firstTexture + entry.textureCount; t++)
+            {
+                const MeshCacheTexture &ref = textures[t];
+                if (ref.typeOffset + ref.typeLength > header.stringsSize ||
+                    ref.pathOffset + ref.pathLength > header.stringsSize)
+                    return false;
+                Texture texture;
+                texture.id = 0;
+                texture.type.assign(strings + ref.typeOffset, ref.typeLength);
+                texture.path.assign(strings + ref.pathOffset, ref.pathLength);
+                loaded[i].textures.push_back(texture);
+            }
+        }
+        meshes.swap(loaded);
+        return true;
+    }
+
+    static bool Store(const std::string &cachePath, uint64_t key, const std::vector<MeshData> &meshes)
+    {
+        MeshCacheHeader header;
+        memcpy(header.magic, magic(), sizeof(header.magic));
+        header.version = MESH_CACHE_VERSION;
+        header.vertexSize = sizeof(Vertex);
+        header.key = key;
+        header.meshCount = meshes.size();
+        header.textureCount = 0;
+        for (const MeshData &mesh: meshes)
+            header.textureCount += mesh.textures.size();
+
+        std::vector<MeshCacheEntry> entries(meshes.size());
+        std::vector<MeshCacheTexture> textures;
+        std::string strings;
+
+        // tables first, padded so the geometry blobs start aligned
+        size_t offset = sizeof(MeshCacheHeader) + entries.size() * sizeof(MeshCacheEntry) +
+                        header.textureCount * sizeof(MeshCacheTexture);
+        offset = align(offset);
+        for (size_t i = 0; i < meshes.size(); i++)
+        {
+            const MeshData &mesh = meshes[i];
+            MeshCacheEntry &entry = entries[i];
+            entry.vertexCount = mesh.vertices.size();
+            entry.indexCount = mesh.indices.size();
+            entry.verticesOffset = offset;
+            offset = align(offset + mesh.vertices.size() * sizeof(Vertex));
+            entry.indicesOffset = offset;
+            offset = align(offset + mesh.indices.size() * sizeof(unsigned int));
+            entry.clusterCount = mesh.clusters.size();
+            entry.clustersOffset = offset;
+            offset = align(offset + mesh.clusters.size() * sizeof(MeshCluster));
+            entry.lodCount = std::min<size_t>(mesh.lods.size(), MAX_MESH_LODS);
+            memset(entry.lods, 0, sizeof(entry.lods));
+            std::copy(mesh.lods.begin(), mesh.lods.begin() + entry.lodCount, entry.lods);
+            entry.firstTexture = textures.size();
+            entry.textureCount = mesh.textures.size();
+            for (const Texture &texture: mesh.textures)
+            {
+                MeshCacheTexture ref;
+                ref.typeOffset = strings.size();
+                ref.typeLength = texture.type.size();
+                strings += texture.type;
+                ref.pathOffset = strings.size();
+                ref.pathLength = texture.path.size();
+                strings += texture.path;
+                textures.push_back(ref);
+            }
+        }
+        header.stringsOffset = offset;
+        header.stringsSize = strings.size();
+
+        std::string blob;
+        blob.reserve(offset + strings.size());
+        blob.append((const char *)&header, sizeof(header));
+        blob.append((const char *)entries.data(), entries.size() * sizeof(MeshCacheEntry));
+        appendAligned(blob, textures.data(), textures.size() * sizeof(MeshCacheTexture));
+        for (const MeshData &mesh: meshes)
+        {
+            appendAligned(blob, mesh.vertices.data(), mesh.vertices.size() * sizeof(Vertex));
+            appendAligned(blob, mesh.indices.data(), mesh.indices.size() * sizeof(unsigned int));
+            appendAligned(blob, mesh.clusters.data(), mesh.clusters.size() * sizeof(MeshCluster));
+        }
+        blob += strings;
+        return AssetCache::WriteFile(cachePath, blob);
+    }
+
+private:
+    static const char *magic()
+    {
+        return "LOGLMSH";
+    }
+
+    static size_t align(size_t offset)
+    {
+        return (offset + 15) & ~(size_t)15;
+    }
+};
+#endif
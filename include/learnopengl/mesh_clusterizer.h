@@ -0,0 +1,195 @@
+#ifndef MESH_CLUSTERIZER_H
+#define MESH_CLUSTERIZER_H
+
+#include <glm/glm.hpp>
+
+#include <learnopengl/mesh.h>
+
+#include <algorithm>
+#include <cmath>
+#include <vector>
+
+// Splits a mesh's triangles into small clusters (meshlets) that can be culled on their own: each gets a
+// bounding sphere for the frustum test and a normal cone for rejecting clusters that face away from the eye.
+// Clusters are grown greedily over shared vertices, preferring triangles that add no new vertex and face the
+// same way as the cluster so far, which keeps the cones narrow.
+class MeshClusterizer
+{
+public:
+    static const size_t MAX_VERTICES = 64;
+    static const size_t MAX_TRIANGLES = 124;
+
+    // reorders the mesh's triangles cluster by cluster and fills mesh.clusters. runs on LOD 0 only, so it has
+    // to come before MeshSimplifier::BuildLods, and before MeshOptimizer::Optimize, which then orders the
+    // triangles inside each cluster and the clusters themselves.
+    static void Build(MeshData &mesh)
+    {
+        mesh.clusters.clear();
+        size_t triangleCount = mesh.indices.size() / 3;
+        size_t vertexCount = mesh.vertices.size();
+        if (triangleCount == 0)
+            return;
+
+        std::vector<glm::vec3> normals(triangleCount);
+        for (size_t t = 0; t < triangleCount; t++)
+            normals[t] = triangleNormal(mesh, t);
+
+        // triangles around each vertex
+        std::vector<unsigned int> adjacencyOffset(vertexCount + 1, 0);
+        for (unsigned int index: mesh.indices)
+            adjacencyOffset[index + 1]++;
+        for (size_t v = 0; v < vertexCount; v++)
+            adjacencyOffset[v + 1] += adjacencyOffset[v];
+        std::vector<unsigned int> adjacency(mesh.indices.size());
+        {
+            std::vector<unsigned int> fill(adjacencyOffset.begin(), adjacencyOffset.end() - 1);
+            for (size_t i = 0; i < mesh.indices.size(); i++)
+                adjacency[fill[mesh.indices[i]]++] = i / 3;
+        }
+
+        std::vector<bool> emitted(triangleCount, false);
+        std::vector<bool> inCluster(vertexCount, false);
+        std::vector<unsigned int> clusterVertices, candidates, output;
+        output.reserve(mesh.indices.size());
+        size_t scan = 0;
+        while (output.size() < mesh.indices.size())
+        {
+            // seed with the next free triangle in input order
+            while (emitted[scan])
+                scan++;
+            size_t first = output.size();
+            glm::vec3 facing(0.0f);
+            glm::vec3 centroid(0.0f);
+            size_t triangles = 0;
+            candidates.assign(1, scan);
+
+            while (triangles < MAX_TRIANGLES && !candidates.empty())
+            {
+                int best = -1;
+                float bestScore = 0.0f;
+                for (size_t c = 0; c < candidates.size(); c++)
+                {
+                    unsigned int t = candidates[c];
+                    if (emitted[t])
+                        continue;
+                    int fresh = 0;
+                    for (int k = 0; k < 3; k++)
+                        fresh += !inCluster[mesh.indices[3 * t + k]];
+                    if (clusterVertices.size() + fresh > MAX_VERTICES)
+                        continue;
+                    float score = (float)fresh;
+                    if (triangles > 0)
+                    {
+                        glm::vec3 axis = safeNormalize(facing);
+                        score += 2.0f * (1.0f - glm::dot(axis, normals[t]));
+                        score += glm::length(triangleCenter(mesh, t) - centroid / (float)triangles) * 0.1f;
+                    }
+                    if (best < 0 || score < bestScore)
+                    {
+                        best = c;
+                        bestScore = score;
+                    }
+                }
+                if (best < 0)
+                    break;
+
+                unsigned int t = candidates[best];
+                candidates[best] = candidates.back();
+                candidates.pop_back();
+                emitted[t] = true;
+                triangles++;
+                facing += normals[t];
+                centroid += triangleCenter(mesh, t);
+                for (int k = 0; k < 3; k++)
+                {
+                    unsigned int index = mesh.indices[3 * t + k];
+                    output.push_back(index);
+                    if (inCluster[index])
+                        continue;
+                    inCluster[index] = true;
+                    clusterVertices.push_back(index);
+                    for (unsigned int a = adjacencyOffset[index]; a < adjacencyOffset[index + 1]; a++)
+                        if (!emitted[adjacency[a]])
+                            candidates.push_back(adjacency[a]);
+                }
+                // drop duplicates and emitted triangles now and then, so the candidate list stays short
+                if (candidates.size() > 4 * MAX_TRIANGLES)
+                {
+                    std::sort(candidates.begin(), candidates.end());
+                    candidates.erase(std::unique(candidates.begin(), candidates.end()), candidates.end());
+                    candidates.erase(std::remove_if(candidates.begin(), candidates.end(),
+                                                    [&](unsigned int c) { return emitted[c]; }), candidates.end());
+                }
+            }
+
+            mesh.clusters.push_back(bounds(mesh, output, first, output.size() - first));
+            for (unsigned int v: clusterVertices)
+                inCluster[v] = false;
+            clusterVertices.clear();
+        }
+        mesh.indices.swap(output);
+    }
+
+private:
+    static glm::vec3 safeNormalize(const glm::vec3 &v)
+    {
+        float length = glm::length(v);
+        return length > 0.0f ? v / length : glm::vec3(0.0f);
+    }
+
+    static glm::vec3 triangleNormal(const MeshData &mesh, size_t t)
+    {
+        const glm::vec3 &p0 = mesh.vertices[mesh.indices[3 * t]].Position;
+        const glm::vec3 &p1 = mesh.vertices[mesh.indices[3 * t + 1]].Position;
+        const glm::vec3 &p2 = mesh.vertices[mesh.indices[3 * t + 2]].Position;
+        return safeNormalize(glm::cross(p1 - p0, p2 - p0));
+    }
+
+    static glm::vec3 triangleCenter(const MeshData &mesh, size_t t)
+    {
+        return (mesh.vertices[mesh.indices[3 * t]].Position + mesh.vertices[mesh.indices[3 * t + 1]].Position +
+                mesh.vertices[mesh.indices[3 * t + 2]].Position) / 3.0f;
+    }
+
+    // bounding sphere around the box of the cluster's vertices, and the cone around its triangle normals.
+    // the cone test uses the sphere rather than an apex, see ClusterView::Visible.
+    static MeshCluster bounds(const MeshData &mesh, const std::vector<unsigned int> &indices, size_t first, size_t count)
+    {
+        MeshCluster cluster;
+        cluster.indexOffset = first;
+        cluster.indexCount = count;
+
+        glm::vec3 minimum = mesh.vertices[indices[first]].Position, maximum = minimum;
+        for (size_t i = first; i < first + count; i++)
+        {
+            minimum = glm::min(minimum, mesh.vertices[indices[i]].Position);
+            maximum = glm::max(maximum, mesh.vertices[indices[i]].Position);
+        }
+        cluster.center = (minimum + maximum) * 0.5f;
+        cluster.radius = 0.0f;
+        for (size_t i = first; i < first + count; i++)
+            cluster.radius = std::max(cluster.radius, glm::length(mesh.vertices[indices[i]].Position - cluster.center));
+
+        glm::vec3 sum(0.0f);
+        std::vector<glm::vec3> normals;
+        for (size_t i = first; i + 2 < first + count; i += 3)
+        {
+            const glm::vec3 &p0 = mesh.vertices[indices[i]].Position;
+            const glm::vec3 &p1 = mesh.vertices[indices[i + 1]].Position;
+            const glm::vec3 &p2 = mesh.vertices[indices[i + 2]].Position;
+            glm::vec3 normal = safeNormalize(glm::cross(p1 - p0, p2 - p0));
+            if (glm::dot(normal, normal) == 0.0f)
+                continue; // degenerate, faces nowhere
+            normals.push_back(normal);
+            sum += normal;
+        }
+        cluster.coneAxis = safeNormalize(sum);
+        float minDot = normals.empty() ? -1.0f : 1.0f;
+        for (const glm::vec3 &normal: normals)
+            minDot = std::min(minDot, glm::dot(normal, cluster.coneAxis));
+        // past ~84 degrees the cone rarely culls anything and the test gets numerically shaky
+        cluster.coneCutoff = minDot <= 0.1f ? 1.0f : std::sqrt(1.0f - minDot * minDot);
+        return cluster;
+    }
+};
+#endif
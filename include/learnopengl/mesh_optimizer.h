@@ -0,0 +1,552 @@
+#ifndef MESH_OPTIMIZER_H
+#define MESH_OPTIMIZER_H
+
+#include <glm/glm.hpp>
+
+#include <learnopengl/hash.h>
+#include <learnopengl/mesh.h>
+
+#include <algorithm>
+#include <cmath>
+#include <cstring>
+#include <iostream>
+#include <sstream>
+#include <string>
+#include <unordered_map>
+#include <vector>
+
+// post-transform cache statistics of an index buffer, simulated on a FIFO cache
+struct VertexCacheStats {
+    float acmr; // transformed vertices per triangle, 0.5 is ideal, 3 is no reuse at all
+    float atvr; // transformed vertices per referenced vertex, 1 is ideal
+};
+
+struct WeldStats {
+    size_t verticesBefore = 0;
+    size_t verticesAfter = 0;
+};
+
+// Import-time reordering of a mesh for the GPU:
+//  1. triangles are reordered for the post-transform vertex cache (Forsyth's linear-speed optimizer),
+//  2. the resulting triangle runs are split at cache restarts and sorted front-to-back-ish by how much they
+//     face away from the mesh center, which cuts overdraw without giving back the cache locality,
+//  3. vertices are renumbered in first-use order so vertex fetch walks the VBO linearly.
+// A mesh already split into clusters keeps them whole: 1 runs inside each cluster and 2 sorts whole clusters.
+class MeshOptimizer
+{
+public:
+    static const unsigned int FIFO_CACHE_SIZE = 16;
+
+    static VertexCacheStats AnalyzeVertexCache(const std::vector<unsigned int> &indices, size_t vertexCount,
+                                               unsigned int cacheSize = FIFO_CACHE_SIZE)
+    {
+        VertexCacheStats stats = {0.0f, 0.0f};
+        if (indices.empty() || vertexCount == 0)
+            return stats;
+
+        // timestamp of the vertex' last load, a vertex is still cached while it's within cacheSize loads
+        std::vector<unsigned int> loadedAt(vertexCount, 0);
+        std::vector<bool> referenced(vertexCount, false);
+        unsigned int loads = 0, unique = 0;
+        for (unsigned int index: indices)
+        {
+            if (loadedAt[index] == 0 || loads - loadedAt[index] >= cacheSize)
+                loadedAt[index] = ++loads;
+            if (!referenced[index])
+            {
+                referenced[index] = true;
+                unique++;
+            }
+        }
+        stats.acmr = (float)loads / (indices.size() / 3);
+        stats.atvr = (float)loads / unique;
+        return stats;
+    }
+
+    static void OptimizeVertexCache(std::vector<unsigned int> &indices, size_t vertexCount)
+    {
+        const int cacheSize = 32;
+        size_t triangleCount = indices.size() / 3;
+        if (triangleCount == 0)
+            return;
+
+        // triangles adjacent to each vertex, compacted as triangles get emitted
+        std::vector<unsigned int> adjacencyOffset(vertexCount + 1, 0), remaining(vertexCount, 0);
+        for (unsigned int index: indices)
+            remaining[index]++;
+        for (size_t v = 0; v < vertexCount; v++)
+            adjacencyOffset[v + 1] = adjacencyOffset[v] + remaining[v];
+        std::vector<unsigned int> adjacency(indices.size());
+        {
+            std::vector<unsigned int> fill(adjacencyOffset.begin(), adjacencyOffset.end() - 1);
+            for (size_t t = 0; t < triangleCount; t++)
+                for (int k = 0; k < 3; k++)
+                    adjacency[fill[indices[3 * t + k]]++] = t;
+        }
+
+        std::vector<int> cachePosition(vertexCount, -1);
+        std::vector<float> vertexScore(vertexCount);
+        for (size_t v = 0; v < vertexCount; v++)
+            vertexScore[v] = forsythScore(-1, remaining[v], cacheSize);
+        std::vector<float> triangleScore(triangleCount);
+        for (size_t t = 0; t < triangleCount; t++)
+            triangleScore[t] = vertexScore[indices[3 * t]] + vertexScore[indices[3 * t + 1]] + vertexScore[indices[3 * t + 2]];
+
+        std::vector<bool> emitted(triangleCount, false);
+        std::vector<unsigned int> cache, nextCache;
+        std::vector<unsigned int> output;
+        output.reserve(indices.size());
+        size_t scan = 0;
+
+        int best = -1;
+        while (output.size() < indices.size())
+        {
+            if (best < 0)
+            {
+                // nothing in the cache touches a pending triangle, restart from the next one in input order
+                while (emitted[scan])
+                    scan++;
+                best = scan;
+            }
+
+            unsigned int triangle[3] = {indices[3 * best], indices[3 * best + 1], indices[3 * best + 2]};
+            emitted[best] = true;
+            output.insert(output.end(), triangle, triangle + 3);
+
+            for (unsigned int v: triangle)
+            {
+                unsigned int *begin = &adjacency[adjacencyOffset[v]];
+                unsigned int *end = begin + remaining[v];
+                std::iter_swap(std::find(begin, end, (unsigned int)best), end - 1);
+                remaining[v]--;
+            }
+
+            // LRU update: the triangle's vertices move to the front
+            nextCache.assign(triangle, triangle + 3);
+            for (unsigned int v: cache)
+                if (v != triangle[0] && v != triangle[1] && v != triangle[2])
+                    nextCache.push_back(v);
+            for (size_t i = 0; i < nextCache.size(); i++)
+            {
+                unsigned int v = nextCache[i];
+                cachePosition[v] = i < (size_t)cacheSize ? (int)i : -1;
+                vertexScore[v] = forsythScore(cachePosition[v], remaining[v], cacheSize);
+            }
+            if (nextCache.size() > (size_t)cacheSize)
+                nextCache.resize(cacheSize);
+            cache.swap(nextCache);
+
+            // only triangles around cached vertices changed score, the best of them goes next
+            best = -1;
+            float bestScore = -1.0f;
+            for (unsigned int v: cache)
+            {
+                for (unsigned int a = adjacencyOffset[v]; a < adjacencyOffset[v] + remaining[v]; a++)
+                {
+                    unsigned int t = adjacency[a];
+                    triangleScore[t] = vertexScore[indices[3 * t]] + vertexScore[indices[3 * t + 1]] + vertexScore[indices[3 * t + 2]];
+                    if (triangleScore[t] > bestScore)
+                    {
+                        bestScore = triangleScore[t];
+                        best = t;
+                    }
+                }
+            }
+        }
+        indices.swap(output);
+    }
+
+    // sorts runs of cache-coherent triangles so that outward-facing runs are drawn first.
+    // a run ends where a triangle had to load all three vertices anyway, so reordering runs costs no cache hits.
+    // the result is dropped if the ACMR grows by more than `threshold`.
+    static void OptimizeOverdraw(std::vector<unsigned int> &indices, const std::vector<Vertex> &vertices, float threshold = 1.05f)
+    {
+        size_t triangleCount = indices.size() / 3;
+        if (triangleCount < 2)
+            return;
+        VertexCacheStats before = AnalyzeVertexCache(indices, vertices.size());
+
+        std::vector<size_t> clusterStart;
+        std::vector<unsigned int> loadedAt(vertices.size(), 0);
+        unsigned int loads = 0;
+        for (size_t t = 0; t < triangleCount; t++)
+        {
+            int misses = 0;
+            for (int k = 0; k < 3; k++)
+            {
+                unsigned int index = indices[3 * t + k];
+                if (loadedAt[index] == 0 || loads - loadedAt[index] >= FIFO_CACHE_SIZE)
+                {
+                    loadedAt[index] = ++loads;
+                    misses++;
+                }
+            }
+            if (t == 0 || misses == 3)
+                clusterStart.push_back(t);
+        }
+        clusterStart.push_back(triangleCount);
+        size_t clusterCount = clusterStart.size() - 1;
+        if (clusterCount < 2)
+            return;
+
+        glm::vec3 center = meshCenter(vertices);
+        std::vector<std::pair<float, size_t>> order(clusterCount);
+        for (size_t c = 0; c < clusterCount; c++)
+            order[c] = std::make_pair(-outwardness(indices, vertices, clusterStart[c], clusterStart[c + 1], center), c);
+        std::stable_sort(order.begin(), order.end());
+
+        std::vector<unsigned int> sorted;
+        sorted.reserve(indices.size());
+        for (const auto &entry: order)
+            sorted.insert(sorted.end(), indices.begin() + 3 * clusterStart[entry.second], indices.begin() + 3 * clusterStart[entry.second + 1]);
+
+        VertexCacheStats after = AnalyzeVertexCache(sorted, vertices.size());
+        if (after.acmr <= before.acmr * threshold)
+            indices.swap(sorted);
+    }
+
+    // renumbers vertices in the order the index buffer first touches them and drops unreferenced ones
+    static void OptimizeVertexFetch(std::vector<Vertex> &vertices, std::vector<unsigned int> &indices)
+    {
+        const unsigned int unused = ~0u;
+        std::vector<unsigned int> remap(vertices.size(), unused);
+        std::vector<Vertex> reordered;
+        reordered.reserve(vertices.size());
+        for (unsigned int &index: indices)
+        {
+            if (remap[index] == unused)
+            {
+                remap[index] = reordered.size();
+                reordered.push_back(vertices[index]);
+            }
+            index = remap[index];
+        }
+        vertices.swap(reordered);
+    }
+
+    // merges identical vertices and remaps the indices. positions have to match exactly; normals, tangents and
+    // bitangents are compared after rounding to `normalEpsilon` and texture coordinates to `texCoordEpsilon`
+    // (0 compares exactly). merged vertices take the values of the first one. runs before clustering and LODs.
+    static WeldStats WeldVertices(MeshData &mesh, float normalEpsilon = 0.0f, float texCoordEpsilon = 0.0f)
+    {
+        WeldStats stats;
+        stats.verticesBefore = stats.verticesAfter = mesh.vertices.size();
+        if (mesh.vertices.empty())
+            return stats;
+
+        const size_t keySize = 14;
+        std::vector<uint32_t> keys(mesh.vertices.size() * keySize);
+        for (size_t v = 0; v < mesh.vertices.size(); v++)
+        {
+            const Vertex &vertex = mesh.vertices[v];
+            uint32_t *key = &keys[v * keySize];
+            for (int k = 0; k < 3; k++)
+            {
+                key[k] = weldKey(vertex.Position[k], 0.0f);
+                key[3 + k] = weldKey(vertex.Normal[k], normalEpsilon);
+                key[6 + k] = weldKey(vertex.Tangent[k], normalEpsilon);
+                key[9 + k] = weldKey(vertex.Bitangent[k], normalEpsilon);
+            }
+            key[12] = weldKey(vertex.TexCoords.x, texCoordEpsilon);
+            key[13] = weldKey(vertex.TexCoords.y, texCoordEpsilon);
+        }
+
+        // the table holds vertex numbers and looks their keys up, so no key is stored twice
+        auto hash = [&](unsigned int v) { return (size_t)fnv1a(&keys[v * keySize], keySize * sizeof(uint32_t)); };
+        auto equal = [&](unsigned int a, unsigned int b) {
+            return memcmp(&keys[a * keySize], &keys[b * keySize], keySize * sizeof(uint32_t)) == 0;
+        };
+        std::unordered_map<unsigned int, unsigned int, decltype(hash), decltype(equal)> welded(mesh.vertices.size(), hash, equal);
+        std::vector<unsigned int> remap(mesh.vertices.size());
+        std::vector<Vertex> vertices;
+        vertices.reserve(mesh.vertices.size());
+        for (size_t v = 0; v < mesh.vertices.size(); v++)
+        {
+            auto inserted = welded.insert(std::make_pair((unsigned int)v, (unsigned int)vertices.size()));
+            if (inserted.second)
+                vertices.push_back(mesh.vertices[v]);
+            remap[v] = inserted.first->second;
+        }
+        for (unsigned int &index: mesh.indices)
+            index = remap[index];
+        vertices.shrink_to_fit();
+        mesh.vertices.swap(vertices);
+        stats.verticesAfter = mesh.vertices.size();
+        return stats;
+    }
+
+    // Forsyth's order inside each cluster, which stays where it is. works in the cluster's own vertex numbers,
+    // so a cluster costs its own size rather than the mesh's.
+    static void OptimizeClusterCache(MeshData &mesh)
+    {
+        const unsigned int unused = ~0u;
+        std::vector<unsigned int> local(mesh.vertices.size(), unused);
+        std::vector<unsigned int> global, range;
+        for (const MeshCluster &cluster: mesh.clusters)
+        {
+            range.assign(mesh.indices.begin() + cluster.indexOffset,
+                         mesh.indices.begin() + cluster.indexOffset + cluster.indexCount);
+            for (unsigned int &index: range)
+            {
+                if (local[index] == unused)
+                {
+                    local[index] = global.size();
+                    global.push_back(index);
+                }
+                index = local[index];
+            }
+            OptimizeVertexCache(range, global.size());
+            for (size_t i = 0; i < range.size(); i++)
+                mesh.indices[cluster.indexOffset + i] = global[range[i]];
+            for (unsigned int v: global)
+                local[v] = unused;
+            global.clear();
+        }
+    }
+
+    // the overdraw sort with the clusters as runs: outward-facing clusters are drawn first. clusters share
+    // next to no vertices within a FIFO_CACHE_SIZE window, so unlike OptimizeOverdraw there is nothing to give
+    // back. the clusters have to cover the whole index buffer, i.e. run before MeshSimplifier::BuildLods.
+    static void OptimizeClusterOrder(MeshData &mesh)
+    {
+        if (mesh.clusters.size() < 2)
+            return;
+        glm::vec3 center = meshCenter(mesh.vertices);
+        std::vector<std::pair<float, size_t>> order(mesh.clusters.size());
+        for (size_t c = 0; c < mesh.clusters.size(); c++)
+        {
+            const MeshCluster &cluster = mesh.clusters[c];
+            float key = outwardness(mesh.indices, mesh.vertices, cluster.indexOffset / 3,
+                                    (cluster.indexOffset + cluster.indexCount) / 3, center);
+            order[c] = std::make_pair(-key, c);
+        }
+        std::stable_sort(order.begin(), order.end());
+
+        std::vector<unsigned int> sorted;
+        sorted.reserve(mesh.indices.size());
+        std::vector<MeshCluster> clusters;
+        clusters.reserve(mesh.clusters.size());
+        for (const auto &entry: order)
+        {
+            MeshCluster cluster = mesh.clusters[entry.second];
+            auto begin = mesh.indices.begin() + cluster.indexOffset;
+            cluster.indexOffset = sorted.size();
+            sorted.insert(sorted.end(), begin, begin + cluster.indexCount);
+            clusters.push_back(cluster);
+        }
+        mesh.indices.swap(sorted);
+        mesh.clusters.swap(clusters);
+    }
+
+    // runs the whole pipeline on one imported mesh and logs the cache statistics before and after. the
+    // statistics are taken on the index buffer that gets baked, so a clustered mesh is optimized after
+    // MeshClusterizer::Build and before MeshSimplifier::BuildLods.
+    static void Optimize(MeshData &mesh, const std::string &name)
+    {
+        if (mesh.indices.size() < 3 || mesh.vertices.empty())
+            return;
+        VertexCacheStats before = AnalyzeVertexCache(mesh.indices, mesh.vertices.size());
+        if (mesh.clusters.empty())
+        {
+            OptimizeVertexCache(mesh.indices, mesh.vertices.size());
+            OptimizeOverdraw(mesh.indices, mesh.vertices);
+        }
+        else
+        {
+            OptimizeClusterCache(mesh);
+            OptimizeClusterOrder(mesh);
+        }
+        OptimizeVertexFetch(mesh.vertices, mesh.indices);
+        VertexCacheStats after = AnalyzeVertexCache(mesh.indices, mesh.vertices.size());
+
+        // one write per mesh, imports run on several threads
+        std::ostringstream log;
+        log << "MeshOptimizer " << name << ": " << mesh.indices.size() / 3 << " triangles, ACMR " << before.acmr
+            << " -> " << after.acmr << ", ATVR " << before.atvr << " -> " << after.atvr << "\n";
+        std::cout << log.str();
+    }
+
+    // splits a mesh into consecutive runs of triangles that each reference at most `maxVertices` vertices,
+    // so every chunk can be drawn with 16-bit indices. triangle order is kept, so the cache optimization survives.
+    // clusters are kept whole and move into the chunk holding them. every chunk gets every LOD: a level's
+    // triangles go to the chunk that took their first vertex, which gets their other vertices too if it lacks
+    // them. chunks of one mesh hold parts of the same levels, so they have to pick the same one (see
+    // Model::Upload). when the LOD vertices overflow a chunk, LOD 0 is split again with less room per chunk;
+    // a mesh whose LODs never fit is kept whole, with 32-bit indices.
+    // takes the mesh by value: moved in, a mesh that needs no split moves on as the only chunk without a copy.
+    static std::vector<MeshData> SplitForShortIndices(MeshData mesh, size_t maxVertices = 0x10000)
+    {
+        std::vector<MeshData> chunks;
+        if (mesh.vertices.size() > maxVertices)
+        {
+            size_t step = std::max<size_t>(1, maxVertices / 8);
+            for (size_t lod0Vertices = maxVertices; lod0Vertices >= maxVertices / 2; lod0Vertices -= step)
+                if (splitChunks(mesh, lod0Vertices, maxVertices, chunks))
+                    return chunks;
+        }
+        chunks.clear();
+        chunks.push_back(std::move(mesh));
+        return chunks;
+    }
+
+private:
+    // SplitForShortIndices with LOD 0 filling each chunk up to `lod0Vertices`; false if a chunk ends up with
+    // more than `maxVertices` once the other LODs are added
+    static bool splitChunks(const MeshData &mesh, size_t lod0Vertices, size_t maxVertices, std::vector<MeshData> &chunks)
+    {
+        // LOD 0 is split between units: its clusters, or single triangles when it has none
+        std::vector<MeshCluster> units(mesh.clusters);
+        if (units.empty())
+        {
+            size_t lod0Count = mesh.lods.empty() ? mesh.indices.size() : mesh.lods[0].indexCount;
+            for (size_t t = 0; t + 2 < lod0Count; t += 3)
+                units.push_back(MeshCluster{(uint32_t)t, 3, glm::vec3(0.0f), 0.0f, glm::vec3(0.0f), 1.0f});
+        }
+
+        const unsigned int unused = ~0u;
+        std::vector<unsigned int> remap(mesh.vertices.size(), unused);
+        std::vector<unsigned int> counted(mesh.vertices.size(), unused);
+        std::vector<unsigned int> owner(mesh.vertices.size(), unused); // first chunk that took the vertex
+        std::vector<std::vector<unsigned int>> sources(1);             // mesh vertex of each chunk vertex
+        chunks.assign(1, MeshData());
+        for (size_t u = 0; u < units.size(); u++)
+        {
+            const MeshCluster &unit = units[u];
+            size_t fresh = 0;
+            for (size_t i = unit.indexOffset; i < unit.indexOffset + unit.indexCount; i++)
+            {
+                unsigned int index = mesh.indices[i];
+                if (remap[index] == unused && counted[index] != u)
+                {
+                    counted[index] = u;
+                    fresh++;
+                }
+            }
+            if (!chunks.back().indices.empty() && chunks.back().vertices.size() + fresh > lod0Vertices)
+            {
+                for (unsigned int v: sources.back())
+                    remap[v] = unused;
+                chunks.push_back(MeshData());
+                sources.push_back(std::vector<unsigned int>());
+            }
+            MeshData &chunk = chunks.back();
+            if (!mesh.clusters.empty())
+            {
+                chunk.clusters.push_back(unit);
+                chunk.clusters.back().indexOffset = chunk.indices.size();
+            }
+            for (size_t i = unit.indexOffset; i < unit.indexOffset + unit.indexCount; i++)
+            {
+                unsigned int index = mesh.indices[i];
+                if (remap[index] == unused)
+                {
+                    remap[index] = chunk.vertices.size();
+                    chunk.vertices.push_back(mesh.vertices[index]);
+                    sources.back().push_back(index);
+                    if (owner[index] == unused)
+                        owner[index] = chunks.size() - 1;
+                }
+                chunk.indices.push_back(remap[index]);
+            }
+        }
+        for (unsigned int v: sources.back())
+            remap[v] = unused;
+
+        for (size_t c = 0; c < chunks.size(); c++)
+        {
+            MeshData &chunk = chunks[c];
+            chunk.textures = mesh.textures;
+            chunk.lods.push_back(MeshLod{0, (uint32_t)chunk.indices.size(), 0.0f});
+            for (size_t i = 0; i < sources[c].size(); i++)
+                remap[sources[c][i]] = i;
+            for (size_t l = 1; l < mesh.lods.size(); l++)
+            {
+                const MeshLod &lod = mesh.lods[l];
+                size_t first = chunk.indices.size();
+                for (size_t i = lod.indexOffset; i + 2 < lod.indexOffset + lod.indexCount; i += 3)
+                {
+                    // a vertex LOD 0 doesn't use has no owner, chunk 0 takes its triangles
+                    unsigned int taker = owner[mesh.indices[i]];
+                    if ((taker == unused ? 0 : taker) != c)
+                        continue;
+                    for (int k = 0; k < 3; k++)
+                    {
+                        unsigned int index = mesh.indices[i + k];
+                        if (remap[index] == unused)
+                        {
+                            remap[index] = chunk.vertices.size();
+                            chunk.vertices.push_back(mesh.vertices[index]);
+                            sources[c].push_back(index);
+                        }
+                        chunk.indices.push_back(remap[index]);
+                    }
+                }
+                chunk.lods.push_back(MeshLod{(uint32_t)first, (uint32_t)(chunk.indices.size() - first), lod.error});
+            }
+            for (unsigned int v: sources[c])
+                remap[v] = unused;
+            if (chunk.vertices.size() > maxVertices)
+                return false;
+        }
+        return true;
+    }
+
+    static glm::vec3 meshCenter(const std::vector<Vertex> &vertices)
+    {
+        glm::vec3 center(0.0f);
+        for (const Vertex &vertex: vertices)
+            center += vertex.Position;
+        return center / (float)vertices.size();
+    }
+
+    // dot(run center - mesh center, run normal) over triangles [first, end): large for runs on the outer hull
+    static float outwardness(const std::vector<unsigned int> &indices, const std::vector<Vertex> &vertices,
+                             size_t first, size_t end, const glm::vec3 &meshCenter)
+    {
+        glm::vec3 center(0.0f), normal(0.0f);
+        float area = 0.0f;
+        for (size_t t = first; t < end; t++)
+        {
+            const glm::vec3 &p0 = vertices[indices[3 * t]].Position;
+            const glm::vec3 &p1 = vertices[indices[3 * t + 1]].Position;
+            const glm::vec3 &p2 = vertices[indices[3 * t + 2]].Position;
+            glm::vec3 faceNormal = glm::cross(p1 - p0, p2 - p0);
+            float faceArea = glm::length(faceNormal);
+            center += (p0 + p1 + p2) * (faceArea / 3.0f);
+            normal += faceNormal;
+            area += faceArea;
+        }
+        if (area > 0.0f)
+            center /= area;
+        float normalLength = glm::length(normal);
+        return normalLength > 0.0f ? glm::dot(center - meshCenter, normal / normalLength) : 0.0f;
+    }
+
+    // bit pattern of a value, or its bucket index when it's compared with a tolerance. -0 and 0 key the same.
+    static uint32_t weldKey(float value, float epsilon)
+    {
+        if (epsilon > 0.0f)
+            return (uint32_t)(int32_t)std::floor(value / epsilon + 0.5f);
+        value += 0.0f;
+        uint32_t bits;
+        memcpy(&bits, &value, sizeof(bits));
+        return bits;
+    }
+
+    // Forsyth's vertex score: recently used vertices and vertices with few pending triangles score higher
+    static float forsythScore(int cachePosition, unsigned int remainingTriangles, int cacheSize)
+    {
+        if (remainingTriangles == 0)
+            return -1.0f;
+        float score = 0.0f;
+        if (cachePosition >= 0)
+        {
+            if (cachePosition < 3)
+                score = 0.75f;
+            else
+                score = std::pow(1.0f - (float)(cachePosition - 3) / (cacheSize - 3), 1.5f);
+        }
+        return score + 2.0f / std::sqrt((float)remainingTriangles);
+    }
+};
+#endif
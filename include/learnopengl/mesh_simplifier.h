@@ -0,0 +1,312 @@
+#ifndef MESH_SIMPLIFIER_H
+#define MESH_SIMPLIFIER_H
+
+#include <glm/glm.hpp>
+
+#include <learnopengl/mesh.h>
+#include <learnopengl/mesh_optimizer.h>
+
+#include <algorithm>
+#include <cmath>
+#include <cstring>
+#include <unordered_map>
+#include <vector>
+
+// Quadric error metric edge collapse (Garland & Heckbert) working on the index buffer only: a collapse moves
+// one vertex onto a neighbour, so the vertex buffer is shared by all LODs of a mesh.
+// Vertices on UV/normal seams (another vertex at the same position) and on open borders are locked, which
+// keeps seams and silhouettes of open meshes from tearing; collapses that would flip a triangle are rejected.
+class MeshSimplifier
+{
+public:
+    // returns a simplified copy of `indices` with at most `targetIndexCount` indices, or as close as it gets
+    // without any collapse exceeding `maxError` (object-space distance). `resultError` receives the largest
+    // error of the collapses made.
+    static std::vector<unsigned int> Simplify(const std::vector<Vertex> &vertices, const std::vector<unsigned int> &indices,
+                                              size_t targetIndexCount, float maxError, float &resultError)
+    {
+        size_t vertexCount = vertices.size();
+        std::vector<unsigned int> result(indices);
+        resultError = 0.0f;
+        if (result.size() <= targetIndexCount || vertexCount == 0)
+            return result;
+
+        // vertices sharing a position share a quadric; more than one vertex at a position means a seam
+        std::vector<unsigned int> positionId(vertexCount);
+        std::vector<unsigned int> positionUses;
+        {
+            std::unordered_map<PositionKey, unsigned int, PositionHash> positions;
+            positions.reserve(vertexCount);
+            for (size_t v = 0; v < vertexCount; v++)
+            {
+                auto inserted = positions.insert(std::make_pair(PositionKey(vertices[v].Position), (unsigned int)positions.size()));
+                positionId[v] = inserted.first->second;
+                if (inserted.second)
+                    positionUses.push_back(0);
+                positionUses[positionId[v]]++;
+            }
+        }
+        std::vector<bool> locked(vertexCount, false);
+        for (size_t v = 0; v < vertexCount; v++)
+            locked[v] = positionUses[positionId[v]] > 1;
+        lockBorders(result, positionId, locked);
+
+        std::vector<Quadric> quadrics(positionUses.size());
+        for (size_t t = 0; t + 2 < result.size(); t += 3)
+        {
+            Quadric plane = Quadric::FromTriangle(vertices[result[t]].Position, vertices[result[t + 1]].Position,
+                                                  vertices[result[t + 2]].Position);
+            for (int k = 0; k < 3; k++)
+                quadrics[positionId[result[t + k]]].Add(plane);
+        }
+
+        std::vector<unsigned int> remap(vertexCount);
+        std::vector<bool> touched(vertexCount);
+        std::vector<Collapse> collapses;
+        double maxCost = (double)maxError * maxError;
+        while (result.size() > targetIndexCount)
+        {
+            // triangles around each vertex for this pass
+            std::vector<unsigned int> adjacencyOffset(vertexCount + 1, 0);
+            for (unsigned int index: result)
+                adjacencyOffset[index + 1]++;
+            for (size_t v = 0; v < vertexCount; v++)
+                adjacencyOffset[v + 1] += adjacencyOffset[v];
+            std::vector<unsigned int> adjacency(result.size()), fill(adjacencyOffset.begin(), adjacencyOffset.end() - 1);
+            for (size_t i = 0; i < result.size(); i++)
+                adjacency[fill[result[i]]++] = i / 3;
+
+            collapses.clear();
+            for (size_t t = 0; t + 2 < result.size(); t += 3)
+            {
+                for (int k = 0; k < 3; k++)
+                {
+                    unsigned int a = result[t + k], b = result[t + (k + 1) % 3];
+                    if (!locked[a])
+                        collapses.push_back(Collapse{a, b, cost(quadrics, positionId, vertices, a, b)});
+                    if (!locked[b])
+                        collapses.push_back(Collapse{b, a, cost(quadrics, positionId, vertices, b, a)});
+                }
+            }
+            std::sort(collapses.begin(), collapses.end(), [](const Collapse &x, const Collapse &y) { return x.cost < y.cost; });
+
+            for (size_t v = 0; v < vertexCount; v++)
+                remap[v] = v;
+            std::fill(touched.begin(), touched.end(), false);
+            size_t trianglesLeft = result.size() / 3;
+            size_t targetTriangles = targetIndexCount / 3;
+            size_t performed = 0;
+            for (const Collapse &collapse: collapses)
+            {
+                if (trianglesLeft <= targetTriangles || collapse.cost > maxCost)
+                    break;
+                unsigned int a = collapse.from, b = collapse.to;
+                if (touched[a] || touched[b] || flips(vertices, result, adjacency, adjacencyOffset, a, b))
+                    continue;
+
+                // the one-ring of `a` changes, keep it out of the rest of this pass
+                for (unsigned int i = adjacencyOffset[a]; i < adjacencyOffset[a + 1]; i++)
+                {
+                    unsigned int t = adjacency[i];
+                    bool shared = false;
+                    for (int k = 0; k < 3; k++)
+                    {
+                        touched[result[3 * t + k]] = true;
+                        shared = shared || result[3 * t + k] == b;
+                    }
+                    if (shared)
+                        trianglesLeft--;
+                }
+                remap[a] = b;
+                quadrics[positionId[b]].Add(quadrics[positionId[a]]);
+                resultError = std::max(resultError, (float)std::sqrt(std::max(collapse.cost, 0.0)));
+                performed++;
+            }
+            if (performed == 0)
+                break;
+
+            // apply the collapses and drop the triangles that became degenerate
+            size_t write = 0;
+            for (size_t t = 0; t + 2 < result.size(); t += 3)
+            {
+                unsigned int i0 = remap[result[t]], i1 = remap[result[t + 1]], i2 = remap[result[t + 2]];
+                if (i0 == i1 || i1 == i2 || i0 == i2)
+                    continue;
+                result[write++] = i0;
+                result[write++] = i1;
+                result[write++] = i2;
+            }
+            result.resize(write);
+        }
+        return result;
+    }
+
+    // appends up to `maxLods` - 1 simplified levels to the mesh, each aiming at half the triangles of the
+    // previous one. levels stop once simplification stalls (mostly seams) or the error passes `maxRelativeError`
+    // of the mesh radius. LOD 0 is the mesh as it is.
+    static void BuildLods(MeshData &mesh, int maxLods = MAX_MESH_LODS, float maxRelativeError = 0.05f)
+    {
+        mesh.lods.clear();
+        mesh.lods.push_back(MeshLod{0, (uint32_t)mesh.indices.size(), 0.0f});
+        if (mesh.vertices.empty() || mesh.indices.size() < 3 * 64)
+            return;
+
+        glm::vec3 minimum = mesh.vertices[0].Position, maximum = minimum;
+        for (const Vertex &vertex: mesh.vertices)
+        {
+            minimum = glm::min(minimum, vertex.Position);
+            maximum = glm::max(maximum, vertex.Position);
+        }
+        float maxError = glm::length(maximum - minimum) * 0.5f * maxRelativeError;
+
+        std::vector<unsigned int> previous(mesh.indices);
+        float previousError = 0.0f;
+        for (int level = 1; level < maxLods; level++)
+        {
+            size_t target = previous.size() / 6 * 3;
+            float error;
+            std::vector<unsigned int> lod = Simplify(mesh.vertices, previous, target, maxError, error);
+            if (lod.empty() || lod.size() > previous.size() * 4 / 5)
+                break;
+            MeshOptimizer::OptimizeVertexCache(lod, mesh.vertices.size());
+
+            // errors add up over the levels since each one is simplified from the previous
+            previousError += error;
+            mesh.lods.push_back(MeshLod{(uint32_t)mesh.indices.size(), (uint32_t)lod.size(), previousError});
+            mesh.indices.insert(mesh.indices.end(), lod.begin(), lod.end());
+            previous.swap(lod);
+        }
+    }
+
+private:
+    // symmetric 4x4 quadric, stored as its upper triangle
+    struct Quadric {
+        double a2 = 0, ab = 0, ac = 0, ad = 0, b2 = 0, bc = 0, bd = 0, c2 = 0, cd = 0, d2 = 0;
+
+        // plane quadric of a triangle, weighted by its area
+        static Quadric FromTriangle(const glm::vec3 &p0, const glm::vec3 &p1, const glm::vec3 &p2)
+        {
+            Quadric q;
+            glm::vec3 normal = glm::cross(p1 - p0, p2 - p0);
+            float area = glm::length(normal);
+            if (area <= 0.0f)
+                return q;
+            normal /= area;
+            double a = normal.x, b = normal.y, c = normal.z, d = -glm::dot(normal, p0);
+            double w = area * 0.5;
+            q.a2 = w * a * a; q.ab = w * a * b; q.ac = w * a * c; q.ad = w * a * d;
+            q.b2 = w * b * b; q.bc = w * b * c; q.bd = w * b * d;
+            q.c2 = w * c * c; q.cd = w * c * d;
+            q.d2 = w * d * d;
+            return q;
+        }
+
+        void Add(const Quadric &o)
+        {
+            a2 += o.a2; ab += o.ab; ac += o.ac; ad += o.ad;
+            b2 += o.b2; bc += o.bc; bd += o.bd;
+            c2 += o.c2; cd += o.cd;
+            d2 += o.d2;
+        }
+
+        double Error(const glm::vec3 &p) const
+        {
+            double x = p.x, y = p.y, z = p.z;
+            return a2 * x * x + 2 * ab * x * y + 2 * ac * x * z + 2 * ad * x
+                 + b2 * y * y + 2 * bc * y * z + 2 * bd * y
+                 + c2 * z * z + 2 * cd * z
+                 + d2;
+        }
+    };
+
+    struct Collapse {
+        unsigned int from;
+        unsigned int to;
+        double cost;
+    };
+
+    struct PositionKey {
+        float p[3];
+        explicit PositionKey(const glm::vec3 &position)
+        {
+            p[0] = position.x;
+            p[1] = position.y;
+            p[2] = position.z;
+        }
+        bool operator==(const PositionKey &o) const
+        {
+            return p[0] == o.p[0] && p[1] == o.p[1] && p[2] == o.p[2];
+        }
+    };
+
+    struct PositionHash {
+        size_t operator()(const PositionKey &key) const
+        {
+            uint32_t bits[3];
+            memcpy(bits, key.p, sizeof(bits));
+            return (bits[0] * 73856093u) ^ (bits[1] * 19349663u) ^ (bits[2] * 83492791u);
+        }
+    };
+
+    // the area weighting makes the raw quadric error an area times a squared distance; normalizing by the
+    // accumulated weight turns it back into a squared distance
+    static double cost(const std::vector<Quadric> &quadrics, const std::vector<unsigned int> &positionId,
+                       const std::vector<Vertex> &vertices, unsigned int from, unsigned int to)
+    {
+        Quadric q = quadrics[positionId[from]];
+        q.Add(quadrics[positionId[to]]);
+        double weight = q.a2 + q.b2 + q.c2; // sum of the weights, as every plane normal has unit length
+        return weight > 0 ? q.Error(vertices[to].Position) / weight : 0.0;
+    }
+
+    // locks vertices on edges used by a single triangle (compared by position, so seams don't count as borders)
+    static void lockBorders(const std::vector<unsigned int> &indices, const std::vector<unsigned int> &positionId,
+                            std::vector<bool> &locked)
+    {
+        std::unordered_map<uint64_t, int> edges;
+        edges.reserve(indices.size());
+        for (size_t t = 0; t + 2 < indices.size(); t += 3)
+            for (int k = 0; k < 3; k++)
+                edges[edgeKey(positionId[indices[t + k]], positionId[indices[t + (k + 1) % 3]])]++;
+        for (size_t t = 0; t + 2 < indices.size(); t += 3)
+        {
+            for (int k = 0; k < 3; k++)
+            {
+                unsigned int a = indices[t + k], b = indices[t + (k + 1) % 3];
+                if (edges[edgeKey(positionId[a], positionId[b])] == 1)
+                    locked[a] = locked[b] = true;
+            }
+        }
+    }
+
+    static uint64_t edgeKey(unsigned int a, unsigned int b)
+    {
+        return a < b ? (uint64_t)a << 32 | b : (uint64_t)b << 32 | a;
+    }
+
+    // true if moving `from` onto `to` turns any remaining triangle around `from` over
+    static bool flips(const std::vector<Vertex> &vertices, const std::vector<unsigned int> &indices,
+                      const std::vector<unsigned int> &adjacency, const std::vector<unsigned int> &adjacencyOffset,
+                      unsigned int from, unsigned int to)
+    {
+        for (unsigned int i = adjacencyOffset[from]; i < adjacencyOffset[from + 1]; i++)
+        {
+            unsigned int t = adjacency[i];
+            unsigned int corner[3] = {indices[3 * t], indices[3 * t + 1], indices[3 * t + 2]};
+            if (corner[0] == to || corner[1] == to || corner[2] == to)
+                continue; // collapses away
+            glm::vec3 p[3], q[3];
+            for (int k = 0; k < 3; k++)
+            {
+                p[k] = vertices[corner[k]].Position;
+                q[k] = vertices[corner[k] == from ? to : corner[k]].Position;
+            }
+            glm::vec3 before = glm::cross(p[1] - p[0], p[2] - p[0]);
+            glm::vec3 after = glm::cross(q[1] - q[0], q[2] - q[0]);
+            if (glm::dot(before, after) <= 0.0f)
+                return true;
+        }
+        return false;
+    }
+};
+#endif
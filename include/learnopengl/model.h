@@ -10,32 +10,101 @@
 #include <assimp/scene.h>
 #include <assimp/postprocess.h>
 
+#include <learnopengl/glb_loader.h>
 #include <learnopengl/mesh.h>
+#include <learnopengl/mesh_cache.h>
+#include <learnopengl/mesh_clusterizer.h>
+#include <learnopengl/mesh_optimizer.h>
+#include <learnopengl/mesh_simplifier.h>
+#include <learnopengl/obj_loader.h>
+#include <learnopengl/parallel.h>
 #include <learnopengl/shader.h>
+#include <learnopengl/texture_loader.h>
+#include <learnopengl/texture_registry.h>
 
+#include <algorithm>
+#include <cctype>
 #include <string>
+#include <chrono>
+#include <cstring>
 #include <fstream>
 #include <sstream>
 #include <iostream>
 #include <map>
+#include <memory>
+#include <unordered_map>
 #include <vector>
 using namespace std;
 
 unsigned int TextureFromFile(const char *path, const string &directory, bool gamma = false);
 
+// post-processing applied to every import, also part of the mesh cache key
+const unsigned int importFlags = aiProcess_Triangulate | aiProcess_GenSmoothNormals | aiProcess_FlipUVs | aiProcess_CalcTangentSpace;
+// tolerances of the welding pass that replaces aiProcess_JoinIdenticalVertices, see MeshOptimizer::WeldVertices
+const float weldNormalEpsilon = 1e-3f;
+const float weldTexCoordEpsilon = 1e-5f;
 
 
+
+// everything the CPU half of loading produces: the meshes (imported or read from the mesh cache, or a mapped
+// .glb uploaded as is) and, once DecodeTextures has run, the decoded pixels of every texture they reference.
+struct ModelData {
+    string path;
+    string directory;
+    vector<MeshData> meshes;
+    shared_ptr<GlbAsset> glb;
+    map<string, TextureImage> images;
+    map<string, uint64_t> imageKeys; // registry keys of images that aren't files of their own
+    bool cached = false;
+};
+
+// per-model loading options
+struct ModelOptions {
+    // layout the meshes are uploaded in, see vertex_format.h. the mesh cache always holds full vertices.
+    VertexFormat vertexFormat = VertexFormat::Full;
+    // split meshes with more than 65536 vertices into chunks that can use 16-bit indices
+    bool splitForShortIndices = false;
+    // what the meshes keep in RAM after upload
+    CpuGeometry cpuGeometry = CpuGeometry::Keep;
+};
+
+// screen-size LOD selection, shared by every model
+struct MeshLodSettings {
+    float pixelThreshold = 1.0f; // largest projected error, in pixels, a level may have
+    float hysteresis = 0.25f;    // a coarser level is only taken once its error is this much under the threshold
+    int forcedLod = -1;          // draw every mesh at this level (clamped per mesh), -1 selects by screen size
+};
+
+// what the LOD selection drew since the last Reset
+struct MeshLodStats {
+    size_t trianglesDrawn = 0;
+    size_t trianglesFull = 0; // what the same meshes would have cost at LOD 0
+    size_t meshesAtLod[MAX_MESH_LODS] = {};
+
+    void Reset()
+    {
+        *this = MeshLodStats();
+    }
+};
+
 class Model
 {
 public:
     // model data
-    vector<Texture> textures_loaded;	// stores all the textures loaded so far, optimization to make sure textures aren't loaded more than once.
+    vector<Texture> textures_loaded;	// the textures this model holds a TextureRegistry reference on, one entry per path
     vector<Mesh>    meshes;
     string directory;
     bool gammaCorrection;
+    string glslIdentifierPrefix;
+    ModelOptions options;
+
+    // empty model, filled in later through Upload (see AssetLoader)
+    Model(ModelOptions options = ModelOptions()) : gammaCorrection(false), options(options)
+    {
+    }
 
     // constructor, expects a filepath to a 3D model.
-    Model(string const &path, bool gamma = false) : gammaCorrection(gamma)
+    Model(string const &path, bool gamma = false, ModelOptions options = ModelOptions()) : gammaCorrection(gamma), options(options)
     {
         loadModel(path);
     }
@@ -47,106 +116,378 @@ public:
             meshes[i].Draw(shader);
     }
 
+    // draws the model with each mesh at the coarsest LOD whose error projects to less than the pixel threshold.
+    // meshes drawn at LOD 0 also skip their clusters that are off screen or facing away.
+    // `instance` tells apart several placements of the same model in a frame, each keeps its own LODs so the
+    // hysteresis works per placement.
+    void Draw(Shader &shader, const glm::mat4 &model, const glm::mat4 &view, const glm::mat4 &projection,
+              float viewportHeight, unsigned int instance = 0)
+    {
+        if (instanceLods.size() <= instance)
+            instanceLods.resize(instance + 1);
+        vector<int> &lods = instanceLods[instance];
+        lods.resize(meshes.size(), 0);
+
+        const MeshLodSettings &settings = LodSettings();
+        ClusterView clusterView = ClusterView::FromTransforms(model, view, projection);
+        glm::mat4 modelView = view * model;
+        float scale = std::max(glm::length(glm::vec3(model[0])), std::max(glm::length(glm::vec3(model[1])), glm::length(glm::vec3(model[2]))));
+        // pixels per unit of object-space error at distance 1
+        float pixelsPerUnit = scale * projection[1][1] * viewportHeight * 0.5f;
+        for (unsigned int i = 0; i < meshes.size(); i++)
+        {
+            Mesh &mesh = meshes[i];
+            int last = (int)mesh.lods.size() - 1;
+            int &lod = lods[i];
+            if (settings.forcedLod >= 0)
+                lod = std::min(settings.forcedLod, last);
+            else
+            {
+                float distance = -glm::vec3(modelView * glm::vec4(mesh.boundsCenter, 1.0f)).z - mesh.boundsRadius * scale;
+                float perPixel = pixelsPerUnit / std::max(distance, 0.1f);
+                lod = std::min(lod, last);
+                while (lod > 0 && mesh.lods[lod].error * perPixel > settings.pixelThreshold)
+                    lod--;
+                while (lod < last && mesh.lods[lod + 1].error * perPixel < settings.pixelThreshold * (1.0f - settings.hysteresis))
+                    lod++;
+            }
+            mesh.lod = lod;
+            mesh.Draw(shader, &clusterView);
+
+            MeshLodStats &stats = LodStats();
+            stats.trianglesDrawn += mesh.lods[lod].indexCount / 3;
+            stats.trianglesFull += mesh.lods[0].indexCount / 3;
+            stats.meshesAtLod[lod]++;
+        }
+    }
+
+    static MeshLodSettings &LodSettings()
+    {
+        static MeshLodSettings settings;
+        return settings;
+    }
+
+    static MeshLodStats &LodStats()
+    {
+        static MeshLodStats stats;
+        return stats;
+    }
+
+    // frees the model's geometry and textures, so another model can be streamed into the space.
+    // the arena is compacted once freeing left its free space too scattered.
+    void Release()
+    {
+        for (Mesh& mesh: meshes)
+            mesh.Release();
+        meshes.clear();
+        instanceLods.clear();
+        for (const Texture& texture: textures_loaded)
+            TextureRegistry::Release(texture.id);
+        textures_loaded.clear();
+        loadedIndex.clear();
+        if (glbBuffer)
+            glDeleteBuffers(1, &glbBuffer);
+        glbBuffer = 0;
+        GeometryArena::For(options.vertexFormat).CompactIfFragmented();
+    }
+
     void SetShaderTextureNamePrefix(std::string prefix) {
+        glslIdentifierPrefix = prefix;
         for (Mesh& mesh: meshes) {
             mesh.glslIdentifierPrefix = prefix;
         }
     }
+
+    // CPU half of loading: reads the model from the mesh cache, or imports it with ASSIMP and bakes the cache.
+    // touches no GL state, so it can run on a worker thread.
+    static bool Import(string const &path, ModelData &data)
+    {
+        data.path = path;
+        // retrieve the directory path of the filepath
+        data.directory = path.substr(0, path.find_last_of('/'));
+
+        // binary glTF needs no import: its buffers are uploaded as they are
+        if (hasExtension(path, "glb"))
+        {
+            auto glb = make_shared<GlbAsset>();
+            if (GlbLoader::Load(path, *glb))
+            {
+                data.glb = glb;
+                for (const GlbImage& image: glb->images)
+                    data.imageKeys[image.name] = image.key;
+                return true;
+            }
+        }
+
+        string cachePath = MeshCache::PathFor(path);
+        uint64_t cacheKey = MeshCache::Key(path, importFlags);
+        data.cached = cacheKey != 0 && MeshCache::Load(cachePath, cacheKey, data.meshes);
+        if (data.cached)
+            return true;
+
+        if (!Parse(path, data.meshes))
+            return false;
+        WeldStats weld = PostProcess(path, data.meshes);
+        ostringstream log;
+        log << "Model " << path << ": welded " << weld.verticesBefore << " -> " << weld.verticesAfter << " vertices ("
+            << (weld.verticesBefore ? 100.0f * weld.verticesAfter / weld.verticesBefore : 100.0f) << "%)\n";
+        cout << log.str();
+        if (cacheKey != 0 && !MeshCache::Store(cachePath, cacheKey, data.meshes))
+            cout << "WARNING::MESH_CACHE:: could not write " << cachePath << endl;
+        return true;
+    }
+
+    // reads the source file into meshes. OBJ files go through the native reader unless `native` is false,
+    // everything else (or an OBJ it can't handle) through ASSIMP.
+    static bool Parse(string const &path, vector<MeshData> &meshes, bool native = true)
+    {
+        return (native && hasExtension(path, "obj") && ObjLoader::Load(path, meshes)) || importWithAssimp(path, meshes);
+    }
+
+    // welds the per-corner vertices, groups LOD 0 into cullable clusters, reorders inside and between clusters for
+    // the post-transform cache, overdraw and vertex fetch, then adds the LOD chain; what the mesh cache holds.
+    // meshes are independent, so they go through this in parallel.
+    static WeldStats PostProcess(string const &path, vector<MeshData> &meshes)
+    {
+        vector<WeldStats> welds(meshes.size());
+        ParallelFor(meshes.size(), [&](size_t i) {
+            welds[i] = MeshOptimizer::WeldVertices(meshes[i], weldNormalEpsilon, weldTexCoordEpsilon);
+            MeshClusterizer::Build(meshes[i]);
+            MeshOptimizer::Optimize(meshes[i], path + "#" + to_string(i));
+            MeshSimplifier::BuildLods(meshes[i]);
+        });
+        WeldStats weld;
+        for (const WeldStats& mesh: welds)
+        {
+            weld.verticesBefore += mesh.verticesBefore;
+            weld.verticesAfter += mesh.verticesAfter;
+        }
+        return weld;
+    }
+
+    // decodes every texture referenced by the imported meshes, except those already resident in the
+    // TextureRegistry. also safe to call from a worker thread.
+    static void DecodeTextures(ModelData &data)
+    {
+        for (const MeshData& mesh: data.meshes)
+            for (const Texture& texture: mesh.textures)
+                decodeTexture(data, texture);
+        if (data.glb)
+            for (const GlbPrimitive& primitive: data.glb->primitives)
+                for (const Texture& texture: primitive.textures)
+                    decodeTexture(data, texture);
+    }
+
+    // GL half of loading: uploads the imported meshes and their textures. has to run on the GL thread.
+    void Upload(ModelData &data)
+    {
+        directory = data.directory;
+        if (data.glb)
+            uploadGlb(data);
+        // first mesh and chunk count of every mesh that got split
+        vector<pair<size_t, size_t>> splits;
+        if (options.splitForShortIndices)
+        {
+            vector<MeshData> split;
+            split.reserve(data.meshes.size());
+            for (MeshData& mesh: data.meshes)
+            {
+                vector<MeshData> chunks = MeshOptimizer::SplitForShortIndices(std::move(mesh));
+                if (chunks.size() > 1)
+                    splits.push_back(make_pair(meshes.size() + split.size(), chunks.size()));
+                for (MeshData& chunk: chunks)
+                    split.push_back(std::move(chunk));
+            }
+            data.meshes.swap(split);
+        }
+        meshes.reserve(meshes.size() + data.meshes.size());
+        for (MeshData& mesh: data.meshes)
+        {
+            vector<Texture> textures = loadTextures(mesh.textures, data);
+            meshes.emplace_back(std::move(mesh.vertices), std::move(mesh.indices), std::move(textures), options.vertexFormat,
+                                std::move(mesh.lods), std::move(mesh.clusters));
+            meshes.back().glslIdentifierPrefix = glslIdentifierPrefix;
+            meshes.back().ReleaseCpuGeometry(options.cpuGeometry);
+        }
+        data.meshes.clear();
+        for (const auto& range: splits)
+            shareBounds(range.first, range.second);
+        for (auto& image: data.images)
+            TextureLoader::Free(image.second);
+        data.images.clear();
+        cout << "Model " << data.path << ": " << meshes.size() << " meshes, " << CpuBytes() / 1024 << " KB resident on the CPU" << endl;
+    }
+
+    // RAM held by the model's meshes, after whatever ModelOptions::cpuGeometry released
+    size_t CpuBytes() const
+    {
+        size_t bytes = meshes.capacity() * sizeof(Mesh);
+        for (const Mesh& mesh: meshes)
+            bytes += mesh.CpuBytes();
+        return bytes;
+    }
 private:
     // loads a model with supported ASSIMP extensions from file and stores the resulting meshes in the meshes vector.
+    // the imported tables are baked into a binary cache next to the model, so later runs can skip ASSIMP entirely.
     void loadModel(string const &path)
+    {
+        auto start = chrono::steady_clock::now();
+        ModelData data;
+        if (!Import(path, data))
+            return;
+        Upload(data);
+
+        float ms = chrono::duration<float, milli>(chrono::steady_clock::now() - start).count();
+        cout << "Model " << path << (data.cached ? " (cached)" : " (imported)") << ": " << ms << " ms" << endl;
+    }
+
+    // gives meshes [first, first + count), the chunks of one split mesh, the sphere around all of theirs: they
+    // share the mesh's LOD chain, and picking the level from the same bounds keeps them on the same one
+    void shareBounds(size_t first, size_t count)
+    {
+        glm::vec3 minimum = meshes[first].boundsCenter - glm::vec3(meshes[first].boundsRadius), maximum = minimum;
+        for (size_t i = first; i < first + count; i++)
+        {
+            minimum = glm::min(minimum, meshes[i].boundsCenter - glm::vec3(meshes[i].boundsRadius));
+            maximum = glm::max(maximum, meshes[i].boundsCenter + glm::vec3(meshes[i].boundsRadius));
+        }
+        glm::vec3 center = (minimum + maximum) * 0.5f;
+        float radius = 0.0f;
+        for (size_t i = first; i < first + count; i++)
+            radius = std::max(radius, glm::length(meshes[i].boundsCenter - center) + meshes[i].boundsRadius);
+        for (size_t i = first; i < first + count; i++)
+        {
+            meshes[i].boundsCenter = center;
+            meshes[i].boundsRadius = radius;
+        }
+    }
+
+    static bool hasExtension(const string &path, const char *extension)
+    {
+        string actual = path.substr(path.find_last_of('.') + 1);
+        transform(actual.begin(), actual.end(), actual.begin(), ::tolower);
+        return actual == extension;
+    }
+
+    static bool importWithAssimp(string const &path, vector<MeshData> &meshes)
     {
         // read file via ASSIMP
         Assimp::Importer importer;
-        const aiScene* scene = importer.ReadFile(path, aiProcess_Triangulate | aiProcess_GenSmoothNormals | aiProcess_FlipUVs | aiProcess_CalcTangentSpace);
+        const aiScene* scene = importer.ReadFile(path, importFlags);
         // check for errors
         if(!scene || scene->mFlags & AI_SCENE_FLAGS_INCOMPLETE || !scene->mRootNode) // if is Not Zero
         {
             cout << "ERROR::ASSIMP:: " << importer.GetErrorString() << endl;
-            return;
+            return false;
         }
-        // retrieve the directory path of the filepath
-        directory = path.substr(0, path.find_last_of('/'));
+        // gather the meshes in node order, then convert them in parallel; they're independent
+        vector<aiMesh*> sceneMeshes;
+        collectMeshes(scene->mRootNode, scene, sceneMeshes);
+        size_t first = meshes.size();
+        meshes.resize(first + sceneMeshes.size());
+        vector<double> milliseconds(sceneMeshes.size());
+        size_t vertexCount = 0;
+        ParallelFor(sceneMeshes.size(), [&](size_t i) {
+            auto start = chrono::steady_clock::now();
+            meshes[first + i] = processMesh(sceneMeshes[i], scene);
+            milliseconds[i] = chrono::duration<double, milli>(chrono::steady_clock::now() - start).count();
+        });
+        double total = 0.0;
+        for (size_t i = 0; i < sceneMeshes.size(); i++)
+        {
+            total += milliseconds[i];
+            vertexCount += sceneMeshes[i]->mNumVertices;
+        }
+        ostringstream log;
+        log << "Model " << path << ": converted " << vertexCount << " vertices in " << total << " ms CPU ("
+            << (vertexCount ? total * 1e6 / vertexCount : 0.0) << " ns per vertex)\n";
+        cout << log.str();
+        return true;
+    }
 
-        // process ASSIMP's root node recursively
-        processNode(scene->mRootNode, scene);
+    // registry key of a texture: its file's contents, or the key recorded for an image embedded in the model
+    static uint64_t textureKey(const ModelData &data, const Texture &texture)
+    {
+        auto embedded = data.imageKeys.find(texture.path);
+        if (embedded != data.imageKeys.end())
+            return embedded->second;
+        return TextureRegistry::Key(data.directory + '/' + texture.path);
     }
 
-    // processes a node in a recursive fashion. Processes each individual mesh located at the node and repeats this process on its children nodes (if any).
-    void processNode(aiNode *node, const aiScene *scene)
+    static void decodeTexture(ModelData &data, const Texture &texture)
     {
-        // process each mesh located at the current node
-        for(unsigned int i = 0; i < node->mNumMeshes; i++)
-        {
-            // the node object only contains indices to index the actual objects in the scene.
-            // the scene contains all the data, node is just to keep stuff organized (like relations between nodes).
-            aiMesh* mesh = scene->mMeshes[node->mMeshes[i]];
-            meshes.push_back(processMesh(mesh, scene));
-        }
-        // after we've processed all of the meshes (if any) we then recursively process each of the children nodes
-        for(unsigned int i = 0; i < node->mNumChildren; i++)
+        if (data.images.find(texture.path) != data.images.end() || TextureRegistry::Contains(textureKey(data, texture)))
+            return;
+        if (data.glb)
+            for (const GlbImage& image: data.glb->images)
+                if (image.name == texture.path)
+                {
+                    data.images[texture.path] = TextureLoader::DecodeMemory(data.glb->binary + image.offset, image.size, image.name);
+                    return;
+                }
+        data.images[texture.path] = TextureLoader::Decode(data.directory + '/' + texture.path);
+    }
+
+    // one buffer for the whole binary chunk and a VAO per primitive, the mapping is dropped afterwards
+    void uploadGlb(ModelData &data)
+    {
+        glbBuffer = GlbLoader::UploadBuffer(*data.glb);
+        meshes.reserve(meshes.size() + data.glb->primitives.size());
+        for (const GlbPrimitive& primitive: data.glb->primitives)
         {
-            processNode(node->mChildren[i], scene);
+            MeshVertexArray vertexArray;
+            vertexArray.vao = GlbLoader::CreateVertexArray(primitive, glbBuffer);
+            vertexArray.mode = primitive.mode;
+            vertexArray.indexed = primitive.indexed;
+            vertexArray.indexType = primitive.indexType;
+            vertexArray.indexOffset = primitive.indexOffset;
+            meshes.emplace_back(vertexArray, primitive.count, loadTextures(primitive.textures, data), primitive.boundsMin,
+                                primitive.boundsMax);
+            meshes.back().glslIdentifierPrefix = glslIdentifierPrefix;
         }
+        data.glb.reset();
+    }
 
+    // collects the meshes of a node and, recursively, of its children, in the order processMesh is to see them.
+    // the node object only contains indices to index the actual objects in the scene.
+    static void collectMeshes(aiNode *node, const aiScene *scene, vector<aiMesh*> &meshes)
+    {
+        for(unsigned int i = 0; i < node->mNumMeshes; i++)
+            meshes.push_back(scene->mMeshes[node->mMeshes[i]]);
+        for(unsigned int i = 0; i < node->mNumChildren; i++)
+            collectMeshes(node->mChildren[i], scene, meshes);
     }
 
-    Mesh processMesh(aiMesh *mesh, const aiScene *scene)
+    static MeshData processMesh(aiMesh *mesh, const aiScene *scene)
     {
         // data to fill
-        vector<Vertex> vertices;
-        vector<unsigned int> indices;
-        vector<Texture> textures;
-
-        // walk through each of the mesh's vertices
-        for(unsigned int i = 0; i < mesh->mNumVertices; i++)
+        MeshData data;
+        vector<unsigned int>& indices = data.indices;
+        vector<Texture>& textures = data.textures;
+        indices.reserve(mesh->mNumFaces * 3);
+
+        // interleave ASSIMP's per-attribute arrays straight into the vertex buffer. only the first of the up to
+        // 8 texture coordinate sets is used; tangents only exist where there are texture coordinates.
+        static_assert(sizeof(aiVector3D) == 3 * sizeof(float), "ASSIMP built with double precision");
+        VertexStreams streams;
+        streams.positions = &mesh->mVertices[0].x;
+        if (mesh->HasNormals())
+            streams.normals = &mesh->mNormals[0].x;
+        if (mesh->mTextureCoords[0])
         {
-            Vertex vertex;
-            glm::vec3 vector; // we declare a placeholder vector since assimp_ uses its own vector class that doesn't directly convert to glm's vec3 class so we transfer the data to this placeholder glm::vec3 first.
-            // positions
-            vector.x = mesh->mVertices[i].x;
-            vector.y = mesh->mVertices[i].y;
-            vector.z = mesh->mVertices[i].z;
-            vertex.Position = vector;
-            // normals
-            if (mesh->HasNormals())
+            streams.texCoords = &mesh->mTextureCoords[0][0].x;
+            streams.texCoordStride = 3;
+            if (mesh->HasTangentsAndBitangents())
             {
-                vector.x = mesh->mNormals[i].x;
-                vector.y = mesh->mNormals[i].y;
-                vector.z = mesh->mNormals[i].z;
-                vertex.Normal = vector;
+                streams.tangents = &mesh->mTangents[0].x;
+                streams.bitangents = &mesh->mBitangents[0].x;
             }
-            // texture coordinates
-            if(mesh->mTextureCoords[0]) // does the mesh contain texture coordinates?
-            {
-                glm::vec2 vec;
-                // a vertex can contain up to 8 different texture coordinates. We thus make the assumption that we won't
-                // use models where a vertex can have multiple texture coordinates so we always take the first set (0).
-                vec.x = mesh->mTextureCoords[0][i].x;
-                vec.y = mesh->mTextureCoords[0][i].y;
-                vertex.TexCoords = vec;
-                // tangent
-                vector.x = mesh->mTangents[i].x;
-                vector.y = mesh->mTangents[i].y;
-                vector.z = mesh->mTangents[i].z;
-                vertex.Tangent = vector;
-                // bitangent
-                vector.x = mesh->mBitangents[i].x;
-                vector.y = mesh->mBitangents[i].y;
-                vector.z = mesh->mBitangents[i].z;
-                vertex.Bitangent = vector;
-            }
-            else
-                vertex.TexCoords = glm::vec2(0.0f, 0.0f);
-
-            vertices.push_back(vertex);
-
-
         }
+        VertexInterleaver::Append(streams, mesh->mNumVertices, data.vertices);
         // now wak through each of the mesh's faces (a face is a mesh its triangle) and retrieve the corresponding vertex indices.
         for(unsigned int i = 0; i < mesh->mNumFaces; i++)
         {
-            aiFace face = mesh->mFaces[i];
+            const aiFace& face = mesh->mFaces[i];
             // retrieve all indices of the face and store them in the indices vector
             for(unsigned int j = 0; j < face.mNumIndices; j++)
                 indices.push_back(face.mIndices[j]);
@@ -178,42 +519,62 @@ private:
 
 
 
-        // return a mesh object created from the extracted mesh data
-        return Mesh(vertices, indices, textures);
+        // return the extracted mesh data, textures are loaded once the whole model is imported
+        return data;
     }
 
-    // checks all material textures of a given type and loads the textures if they're not loaded yet.
-    // the required info is returned as a Texture struct.
-    vector<Texture> loadMaterialTextures(aiMaterial *mat, aiTextureType type, string typeName)
+    // collects the material textures of a given type. only the type and path are known at this point,
+    // the textures themselves are loaded by loadTextures.
+    static vector<Texture> loadMaterialTextures(aiMaterial *mat, aiTextureType type, string typeName)
     {
         vector<Texture> textures;
         for(unsigned int i = 0; i < mat->GetTextureCount(type); i++)
         {
             aiString str;
             mat->GetTexture(type, i, &str);
-            // check if texture was loaded before and if so, continue to next iteration: skip loading a new texture
-            bool skip = false;
-            for(unsigned int j = 0; j < textures_loaded.size(); j++)
+            Texture texture;
+            texture.id = 0;
+            texture.type = typeName;
+            texture.path = str.C_Str();
+            textures.push_back(texture);
+        }
+        return textures;
+    }
+
+    // loads the textures referenced by a mesh if they're not loaded yet and fills in their ids.
+    // textures resident in the TextureRegistry are shared, otherwise images already decoded by DecodeTextures
+    // are uploaded directly and anything else is loaded from disk.
+    vector<Texture> loadTextures(vector<Texture> textures, ModelData &data)
+    {
+        for (Texture& texture: textures)
+        {
+            // check if this model loaded the texture before and if so, reuse it: one registry reference per path
+            auto loaded = loadedIndex.find(texture.path);
+            if (loaded != loadedIndex.end())
             {
-                if(std::strcmp(textures_loaded[j].path.data(), str.C_Str()) == 0)
-                {
-                    textures.push_back(textures_loaded[j]);
-                    skip = true; // a texture with the same filepath has already been loaded, continue to next one. (optimization)
-                    break;
-                }
+                texture.id = textures_loaded[loaded->second].id;
+                continue;
             }
-            if(!skip)
-            {   // if texture hasn't been loaded already, load it
-                Texture texture;
-                texture.id = TextureFromFile(str.C_Str(), this->directory);
-                texture.type = typeName;
-                texture.path = str.C_Str();
-                textures.push_back(texture);
-                textures_loaded.push_back(texture);  // store it as texture loaded for entire model, to ensure we won't unnecesery load duplicate textures.
+
+            uint64_t key = textureKey(data, texture);
+            texture.id = TextureRegistry::Acquire(key);
+            if (texture.id == 0)
+            {
+                auto image = data.images.find(texture.path);
+                if (image != data.images.end())
+                    texture.id = TextureRegistry::Insert(key, TextureStreamer::Upload2D(std::move(image->second)));
+                else
+                    texture.id = TextureFromFile(texture.path.c_str(), this->directory);
             }
+            loadedIndex[texture.path] = textures_loaded.size();
+            textures_loaded.push_back(texture);
         }
         return textures;
     }
+
+    unordered_map<string, size_t> loadedIndex; // path -> position in textures_loaded
+    GLuint glbBuffer = 0;                      // binary chunk of a .glb model, shared by all its meshes
+    vector<vector<int>> instanceLods;          // per Draw instance, the LOD each mesh was drawn at
 };
 
 
@@ -222,38 +583,6 @@ unsigned int TextureFromFile(const char *path, const string &directory, bool gam
     string filename = string(path);
     filename = directory + '/' + filename;
 
-    unsigned int textureID;
-    glGenTextures(1, &textureID);
-
-    int width, height, nrComponents;
-    unsigned char *data = stbi_load(filename.c_str(), &width, &height, &nrComponents, 0);
-    if (data)
-    {
-        GLenum format;
-        if (nrComponents == 1)
-            format = GL_RED;
-        else if (nrComponents == 3)
-            format = GL_RGB;
-        else if (nrComponents == 4)
-            format = GL_RGBA;
-
-        glBindTexture(GL_TEXTURE_2D, textureID);
-        glTexImage2D(GL_TEXTURE_2D, 0, format, width, height, 0, format, GL_UNSIGNED_BYTE, data);
-        glGenerateMipmap(GL_TEXTURE_2D);
-
-        glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_S, GL_REPEAT);
-        glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_T, GL_REPEAT);
-        glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, GL_LINEAR_MIPMAP_LINEAR);
-        glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAG_FILTER, GL_LINEAR);
-
-        stbi_image_free(data);
-    }
-    else
-    {
-        std::cout << "Texture failed to load at path: " << path << std::endl;
-        stbi_image_free(data);
-    }
-
-    return textureID;
+    return TextureRegistry::Load2D(filename);
 }
 #endif
@@ -0,0 +1,548 @@
+#ifndef OBJ_LOADER_H
+#define OBJ_LOADER_H
+
+#include <glm/glm.hpp>
+
+#include <learnopengl/asset_cache.h>
+#include <learnopengl/mesh.h>
+#include <learnopengl/parallel.h>
+
+#include <algorithm>
+#include <atomic>
+#include <climits>
+#include <cmath>
+#include <cstring>
+#include <initializer_list>
+#include <string>
+#include <thread>
+#include <unordered_map>
+#include <vector>
+
+// Native Wavefront OBJ/MTL reader, producing the same MeshData the Assimp path does with importFlags
+// (triangulated, smooth normals where the file has none, flipped UVs, tangent space), one mesh per material.
+// The file is memory mapped and cut into line-aligned chunks that are parsed in parallel; relative (negative)
+// indices and material switches are resolved when the chunks are stitched together.
+class ObjLoader
+{
+public:
+    static bool Load(const std::string &path, std::vector<MeshData> &meshes)
+    {
+        MappedFile file(path);
+        if (!file.valid())
+            return false;
+        const char *begin = (const char *)file.bytes();
+        const char *end = begin + file.length();
+
+        // chunks of at least 256 KB, cut after a newline
+        size_t chunkCount = std::max<size_t>(1, std::min<size_t>(std::max(1u, std::thread::hardware_concurrency()),
+                                                                 file.length() / (256 << 10)));
+        std::vector<const char *> cuts(1, begin);
+        for (size_t c = 1; c < chunkCount; c++)
+        {
+            const char *cut = begin + file.length() * c / chunkCount;
+            cut = std::max(cut, cuts.back());
+            while (cut < end && *cut != '\n')
+                cut++;
+            cuts.push_back(cut < end ? cut + 1 : end);
+        }
+        cuts.push_back(end);
+
+        std::vector<Chunk> chunks(chunkCount);
+        ParallelFor(chunkCount, [&](size_t c) { parseChunk(cuts[c], cuts[c + 1], chunks[c]); });
+
+        // stitch: global attribute arrays, and every triangle sorted into the group of its material
+        std::vector<glm::vec3> positions, normals;
+        std::vector<glm::vec2> texCoords;
+        std::vector<std::string> groupNames;
+        std::vector<std::vector<Corner>> groups;
+        std::unordered_map<std::string, size_t> groupOf;
+        std::string materialLibrary;
+        std::string material;
+        for (Chunk &chunk: chunks)
+        {
+            int base[3] = {(int)positions.size(), (int)texCoords.size(), (int)normals.size()};
+            positions.insert(positions.end(), chunk.positions.begin(), chunk.positions.end());
+            texCoords.insert(texCoords.end(), chunk.texCoords.begin(), chunk.texCoords.end());
+            normals.insert(normals.end(), chunk.normals.begin(), chunk.normals.end());
+            if (materialLibrary.empty())
+                materialLibrary = chunk.materialLibrary;
+
+            size_t change = 0;
+            for (size_t t = 0; t < chunk.corners.size() / 3; t++)
+            {
+                while (change < chunk.materialChanges.size() && chunk.materialChanges[change].first <= t)
+                    material = chunk.materialChanges[change++].second;
+                auto group = groupOf.find(material);
+                if (group == groupOf.end())
+                {
+                    group = groupOf.insert(std::make_pair(material, groups.size())).first;
+                    groups.push_back(std::vector<Corner>());
+                    groupNames.push_back(material);
+                }
+                std::vector<Corner> &corners = groups[group->second];
+                for (int k = 0; k < 3; k++)
+                {
+                    Corner corner = chunk.corners[3 * t + k];
+                    for (int a = 0; a < 3; a++)
+                        if (corner.relative & (1 << a))
+                            corner.index[a] += base[a];
+                    corner.relative = 0;
+                    corners.push_back(corner);
+                }
+            }
+            while (change < chunk.materialChanges.size())
+                material = chunk.materialChanges[change++].second;
+            chunk = Chunk();
+        }
+        if (groups.empty())
+            return false;
+
+        std::string directory = path.substr(0, path.find_last_of('/') + 1);
+        std::unordered_map<std::string, std::vector<Texture>> materials = loadMaterials(directory, materialLibrary, path);
+
+        std::vector<MeshData> result(groups.size());
+        std::atomic<bool> valid(true);
+        ParallelFor(groups.size(), [&](size_t g) {
+            if (!buildMesh(groups[g], positions, texCoords, normals, result[g]))
+                valid.store(false, std::memory_order_relaxed);
+            auto textures = materials.find(groupNames[g]);
+            if (textures != materials.end())
+                result[g].textures = textures->second;
+        });
+        if (!valid)
+            return false;
+        meshes.swap(result);
+        return true;
+    }
+
+    // every .mtl the materials of `path` may come from: each mtllib it names, then the .mtl with the OBJ's own
+    // name that loadMaterials (and Assimp) fall back to. for cache keys, missing ones included
+    static std::vector<std::string> MaterialLibraries(const std::string &path)
+    {
+        std::string directory = path.substr(0, path.find_last_of('/') + 1);
+        std::vector<std::string> libraries;
+        MappedFile file(path);
+        const char *s = (const char *)file.bytes(), *end = s + file.length();
+        while (s < end)
+        {
+            const char *eol = lineEnd(s, end);
+            s = skipSpaces(s, eol);
+            if (eol - s > 7 && strncmp(s, "mtllib", 6) == 0 && (s[6] == ' ' || s[6] == '\t'))
+                libraries.push_back(directory + restOfLine(s + 6, eol));
+            s = eol + (eol < end);
+        }
+        libraries.push_back(path.substr(0, path.find_last_of('.')) + ".mtl");
+        return libraries;
+    }
+
+    // strtod replacement for the plain decimal forms OBJ files use; stops at the first character that
+    // can't continue the number and returns where it stopped
+    static const char *ParseFloat(const char *s, const char *end, float &value)
+    {
+        bool negative = false;
+        if (s < end && (*s == '-' || *s == '+'))
+            negative = *s++ == '-';
+        uint64_t mantissa = 0;
+        int exponent = 0, digits = 0;
+        for (; s < end && *s >= '0' && *s <= '9'; s++)
+        {
+            if (digits < 19)
+            {
+                mantissa = mantissa * 10 + (*s - '0');
+                if (mantissa)
+                    digits++;
+            }
+            else
+                exponent++;
+        }
+        if (s < end && *s == '.')
+        {
+            for (s++; s < end && *s >= '0' && *s <= '9'; s++)
+            {
+                if (digits < 19)
+                {
+                    mantissa = mantissa * 10 + (*s - '0');
+                    if (mantissa)
+                        digits++;
+                    exponent--;
+                }
+            }
+        }
+        if (s < end && (*s == 'e' || *s == 'E'))
+        {
+            const char *e = s + 1;
+            bool negativeExponent = false;
+            if (e < end && (*e == '-' || *e == '+'))
+                negativeExponent = *e++ == '-';
+            if (e < end && *e >= '0' && *e <= '9')
+            {
+                int power = 0;
+                for (; e < end && *e >= '0' && *e <= '9'; e++)
+                    power = std::min(power * 10 + (*e - '0'), 10000);
+                exponent += negativeExponent ? -power : power;
+                s = e;
+            }
+        }
+        double result = (double)mantissa;
+        if (exponent != 0 && mantissa != 0)
+            result = exponent > 0 ? result * pow10(exponent) : result / pow10(-exponent);
+        value = (float)(negative ? -result : result);
+        return s;
+    }
+
+private:
+    static const int MISSING = INT_MIN;
+
+    // one polygon corner: position, texture coordinate and normal index, 0-based. a bit in `relative` marks
+    // an index counted from the start of its chunk rather than the file.
+    struct Corner {
+        int index[3];
+        unsigned char relative;
+    };
+
+    struct Chunk {
+        std::vector<glm::vec3> positions, normals;
+        std::vector<glm::vec2> texCoords;
+        std::vector<Corner> corners; // triangulated, three per triangle
+        std::vector<std::pair<size_t, std::string>> materialChanges; // triangle the usemtl applies from, material
+        std::string materialLibrary;
+    };
+
+    static double pow10(int exponent)
+    {
+        static const double powers[] = {1e0, 1e1, 1e2, 1e3, 1e4, 1e5, 1e6, 1e7, 1e8, 1e9, 1e10, 1e11,
+                                        1e12, 1e13, 1e14, 1e15, 1e16, 1e17, 1e18, 1e19, 1e20, 1e21, 1e22};
+        return exponent <= 22 ? powers[exponent] : std::pow(10.0, exponent);
+    }
+
+    static const char *skipSpaces(const char *s, const char *end)
+    {
+        while (s < end && (*s == ' ' || *s == '\t'))
+            s++;
+        return s;
+    }
+
+    static const char *lineEnd(const char *s, const char *end)
+    {
+        const char *newline = (const char *)memchr(s, '\n', end - s);
+        return newline ? newline : end;
+    }
+
+    // rest of the line with surrounding whitespace (and a \r) trimmed, for names and paths with spaces in them
+    static std::string restOfLine(const char *s, const char *end)
+    {
+        s = skipSpaces(s, end);
+        while (end > s && (end[-1] == '\r' || end[-1] == ' ' || end[-1] == '\t'))
+            end--;
+        return std::string(s, end);
+    }
+
+    static const char *parseInt(const char *s, const char *end, int &value)
+    {
+        bool negative = false;
+        if (s < end && (*s == '-' || *s == '+'))
+            negative = *s++ == '-';
+        long long result = 0;
+        for (; s < end && *s >= '0' && *s <= '9'; s++)
+            result = std::min(result * 10 + (*s - '0'), (long long)INT_MAX);
+        value = (int)(negative ? -result : result);
+        return s;
+    }
+
+    static void parseChunk(const char *s, const char *end, Chunk &chunk)
+    {
+        std::vector<Corner> polygon;
+        while (s < end)
+        {
+            const char *eol = lineEnd(s, end);
+            s = skipSpaces(s, eol);
+            if (eol - s >= 2 && s[0] == 'v' && (s[1] == ' ' || s[1] == '\t'))
+            {
+                glm::vec3 p;
+                const char *c = s + 1;
+                for (int k = 0; k < 3; k++)
+                    c = ParseFloat(skipSpaces(c, eol), eol, p[k]);
+                chunk.positions.push_back(p);
+            }
+            else if (eol - s >= 3 && s[0] == 'v' && s[1] == 't' && (s[2] == ' ' || s[2] == '\t'))
+            {
+                glm::vec2 uv(0.0f);
+                const char *c = s + 2;
+                for (int k = 0; k < 2; k++)
+                    c = ParseFloat(skipSpaces(c, eol), eol, uv[k]);
+                chunk.texCoords.push_back(uv);
+            }
+            else if (eol - s >= 3 && s[0] == 'v' && s[1] == 'n' && (s[2] == ' ' || s[2] == '\t'))
+            {
+                glm::vec3 n;
+                const char *c = s + 2;
+                for (int k = 0; k < 3; k++)
+                    c = ParseFloat(skipSpaces(c, eol), eol, n[k]);
+                chunk.normals.push_back(n);
+            }
+            else if (eol - s >= 2 && s[0] == 'f' && (s[1] == ' ' || s[1] == '\t'))
+            {
+                polygon.clear();
+                const char *c = skipSpaces(s + 1, eol);
+                while (c < eol && *c != '\r')
+                {
+                    Corner corner = {{MISSING, MISSING, MISSING}, 0};
+                    int counts[3] = {(int)chunk.positions.size(), (int)chunk.texCoords.size(), (int)chunk.normals.size()};
+                    for (int a = 0; a < 3; a++)
+                    {
+                        if (a > 0)
+                        {
+                            if (c >= eol || *c != '/')
+                                break;
+                            c++;
+                        }
+                        if (c < eol && (*c == '-' || (*c >= '0' && *c <= '9')))
+                        {
+                            int value;
+                            c = parseInt(c, eol, value);
+                            if (value > 0)
+                                corner.index[a] = value - 1;
+                            else if (value < 0)
+                            {
+                                corner.index[a] = counts[a] + value;
+                                corner.relative |= 1 << a;
+                            }
+                        }
+                    }
+                    if (corner.index[0] != MISSING)
+                        polygon.push_back(corner);
+                    while (c < eol && *c != ' ' && *c != '\t')
+                        c++;
+                    c = skipSpaces(c, eol);
+                }
+                // fan triangulation, like aiProcess_Triangulate does for the convex polygons OBJ exporters write
+                for (size_t k = 2; k < polygon.size(); k++)
+                {
+                    chunk.corners.push_back(polygon[0]);
+                    chunk.corners.push_back(polygon[k - 1]);
+                    chunk.corners.push_back(polygon[k]);
+                }
+            }
+            else if (eol - s > 7 && strncmp(s, "usemtl", 6) == 0 && (s[6] == ' ' || s[6] == '\t'))
+                chunk.materialChanges.push_back(std::make_pair(chunk.corners.size() / 3, restOfLine(s + 6, eol)));
+            else if (eol - s > 7 && strncmp(s, "mtllib", 6) == 0 && (s[6] == ' ' || s[6] == '\t') && chunk.materialLibrary.empty())
+                chunk.materialLibrary = restOfLine(s + 6, eol);
+            // o, g, s and comments don't change what gets drawn
+            s = eol + (eol < end);
+        }
+    }
+
+    // reads newmtl blocks and their texture maps, typed the way Model::processMesh types Assimp's:
+    // map_Kd diffuse, map_Ks specular, map_Bump/bump normal, map_Ka height
+    static std::unordered_map<std::string, std::vector<Texture>> loadMaterials(const std::string &directory,
+                                                                               const std::string &library,
+                                                                               const std::string &objPath)
+    {
+        std::unordered_map<std::string, std::vector<Texture>> materials;
+        MappedFile file(directory + library);
+        if (!file.valid())
+        {
+            // exporters often write the .blend name, Assimp then tries the OBJ's own name
+            file = MappedFile(objPath.substr(0, objPath.find_last_of('.')) + ".mtl");
+            if (!file.valid())
+                return materials;
+        }
+
+        static const char *types[] = {"texture_diffuse", "texture_specular", "texture_normal", "texture_height"};
+        struct Maps {
+            std::vector<std::string> files[4];
+        };
+        std::unordered_map<std::string, Maps> maps;
+        std::vector<std::string> order;
+        std::string current;
+        const char *s = (const char *)file.bytes(), *end = s + file.length();
+        while (s < end)
+        {
+            const char *eol = lineEnd(s, end);
+            s = skipSpaces(s, eol);
+            const char *keyEnd = s;
+            while (keyEnd < eol && *keyEnd != ' ' && *keyEnd != '\t' && *keyEnd != '\r')
+                keyEnd++;
+            std::string key(s, keyEnd);
+            if (key == "newmtl")
+            {
+                current = restOfLine(keyEnd, eol);
+                order.push_back(current);
+                maps[current];
+            }
+            else if (!current.empty())
+            {
+                int type = key == "map_Kd" ? 0 : key == "map_Ks" ? 1 : (key == "map_Bump" || key == "map_bump" || key == "bump") ? 2 :
+                           key == "map_Ka" ? 3 : -1;
+                if (type >= 0)
+                {
+                    std::string file = textureFile(keyEnd, eol);
+                    if (!file.empty())
+                        maps[current].files[type].push_back(file);
+                }
+            }
+            s = eol + (eol < end);
+        }
+
+        for (const std::string &name: order)
+        {
+            std::vector<Texture> &textures = materials[name];
+            for (int type = 0; type < 4; type++)
+            {
+                for (const std::string &path: maps[name].files[type])
+                {
+                    Texture texture;
+                    texture.id = 0;
+                    texture.type = types[type];
+                    texture.path = path;
+                    textures.push_back(texture);
+                }
+            }
+        }
+        return materials;
+    }
+
+    // file name of a map_* statement, skipping its options (-bm 1, -o u v w, ...)
+    static std::string textureFile(const char *s, const char *end)
+    {
+        static const std::pair<const char *, int> options[] = {
+            {"-bm", 1}, {"-blendu", 1}, {"-blendv", 1}, {"-boost", 1}, {"-cc", 1}, {"-clamp", 1}, {"-imfchan", 1},
+            {"-mm", 2}, {"-o", 3}, {"-s", 3}, {"-t", 3}, {"-texres", 1}, {"-type", 1}};
+        s = skipSpaces(s, end);
+        while (s < end && *s == '-')
+        {
+            const char *nameEnd = s;
+            while (nameEnd < end && *nameEnd != ' ' && *nameEnd != '\t')
+                nameEnd++;
+            std::string option(s, nameEnd);
+            int arguments = 0;
+            for (const auto &known: options)
+                if (option == known.first)
+                    arguments = known.second;
+            s = skipSpaces(nameEnd, end);
+            for (int a = 0; a < arguments; a++)
+            {
+                while (s < end && *s != ' ' && *s != '\t')
+                    s++;
+                s = skipSpaces(s, end);
+            }
+        }
+        return restOfLine(s, end);
+    }
+
+    struct CornerHash {
+        size_t operator()(const Corner &corner) const
+        {
+            return ((size_t)corner.index[0] * 73856093u) ^ ((size_t)corner.index[1] * 19349663u) ^ ((size_t)corner.index[2] * 83492791u);
+        }
+    };
+
+    struct CornerEqual {
+        bool operator()(const Corner &a, const Corner &b) const
+        {
+            return a.index[0] == b.index[0] && a.index[1] == b.index[1] && a.index[2] == b.index[2];
+        }
+    };
+
+    // one vertex per distinct position/uv/normal triple, then the normals and tangents the file doesn't have
+    static bool buildMesh(const std::vector<Corner> &corners, const std::vector<glm::vec3> &positions,
+                          const std::vector<glm::vec2> &texCoords, const std::vector<glm::vec3> &normals, MeshData &mesh)
+    {
+        std::unordered_map<Corner, unsigned int, CornerHash, CornerEqual> vertexOf(corners.size() / 2);
+        std::vector<int> positionOf;
+        bool missingNormals = false, hasTexCoords = false;
+        mesh.indices.reserve(corners.size());
+        for (const Corner &corner: corners)
+        {
+            if (corner.index[0] < 0 || corner.index[0] >= (int)positions.size() ||
+                (corner.index[1] != MISSING && (corner.index[1] < 0 || corner.index[1] >= (int)texCoords.size())) ||
+                (corner.index[2] != MISSING && (corner.index[2] < 0 || corner.index[2] >= (int)normals.size())))
+                return false;
+            auto inserted = vertexOf.insert(std::make_pair(corner, (unsigned int)mesh.vertices.size()));
+            if (inserted.second)
+            {
+                Vertex vertex;
+                vertex.Position = positions[corner.index[0]];
+                vertex.Normal = corner.index[2] != MISSING ? normals[corner.index[2]] : glm::vec3(0.0f);
+                vertex.TexCoords = glm::vec2(0.0f);
+                if (corner.index[1] != MISSING)
+                {
+                    // aiProcess_FlipUVs
+                    vertex.TexCoords = glm::vec2(texCoords[corner.index[1]].x, 1.0f - texCoords[corner.index[1]].y);
+                    hasTexCoords = true;
+                }
+                vertex.Tangent = vertex.Bitangent = glm::vec3(0.0f);
+                missingNormals = missingNormals || corner.index[2] == MISSING;
+                mesh.vertices.push_back(vertex);
+                positionOf.push_back(corner.index[0]);
+            }
+            mesh.indices.push_back(inserted.first->second);
+        }
+
+        if (missingNormals)
+            generateNormals(mesh, positionOf);
+        if (hasTexCoords)
+            generateTangents(mesh);
+        return true;
+    }
+
+    // area weighted face normals summed per position, so vertices split by UVs still shade smoothly
+    static void generateNormals(MeshData &mesh, const std::vector<int> &positionOf)
+    {
+        std::unordered_map<int, glm::vec3> sums;
+        for (size_t t = 0; t + 2 < mesh.indices.size(); t += 3)
+        {
+            const glm::vec3 &p0 = mesh.vertices[mesh.indices[t]].Position;
+            const glm::vec3 &p1 = mesh.vertices[mesh.indices[t + 1]].Position;
+            const glm::vec3 &p2 = mesh.vertices[mesh.indices[t + 2]].Position;
+            glm::vec3 normal = glm::cross(p1 - p0, p2 - p0);
+            for (int k = 0; k < 3; k++)
+                sums[positionOf[mesh.indices[t + k]]] += normal;
+        }
+        for (size_t v = 0; v < mesh.vertices.size(); v++)
+        {
+            if (glm::dot(mesh.vertices[v].Normal, mesh.vertices[v].Normal) > 0.0f)
+                continue; // the file had one
+            glm::vec3 normal = sums[positionOf[v]];
+            float length = glm::length(normal);
+            mesh.vertices[v].Normal = length > 0.0f ? normal / length : glm::vec3(0.0f, 1.0f, 0.0f);
+        }
+    }
+
+    // per-triangle tangent frames from the UV gradients, summed per vertex and made orthogonal to the normal
+    static void generateTangents(MeshData &mesh)
+    {
+        for (size_t t = 0; t + 2 < mesh.indices.size(); t += 3)
+        {
+            Vertex &v0 = mesh.vertices[mesh.indices[t]];
+            Vertex &v1 = mesh.vertices[mesh.indices[t + 1]];
+            Vertex &v2 = mesh.vertices[mesh.indices[t + 2]];
+            glm::vec3 edge1 = v1.Position - v0.Position, edge2 = v2.Position - v0.Position;
+            glm::vec2 duv1 = v1.TexCoords - v0.TexCoords, duv2 = v2.TexCoords - v0.TexCoords;
+            float determinant = duv1.x * duv2.y - duv2.x * duv1.y;
+            if (std::fabs(determinant) < 1e-12f)
+                continue;
+            float r = 1.0f / determinant;
+            glm::vec3 tangent = (edge1 * duv2.y - edge2 * duv1.y) * r;
+            glm::vec3 bitangent = (edge2 * duv1.x - edge1 * duv2.x) * r;
+            for (Vertex *vertex: {&v0, &v1, &v2})
+            {
+                vertex->Tangent += tangent;
+                vertex->Bitangent += bitangent;
+            }
+        }
+        for (Vertex &vertex: mesh.vertices)
+        {
+            vertex.Tangent = orthogonalize(vertex.Tangent, vertex.Normal);
+            vertex.Bitangent = orthogonalize(vertex.Bitangent, vertex.Normal);
+        }
+    }
+
+    static glm::vec3 orthogonalize(const glm::vec3 &v, const glm::vec3 &normal)
+    {
+        glm::vec3 projected = v - normal * glm::dot(normal, v);
+        float length = glm::length(projected);
+        return length > 1e-12f ? projected / length : glm::vec3(0.0f);
+    }
+};
+#endif
@@ -0,0 +1,45 @@
+#ifndef PARALLEL_H
+#define PARALLEL_H
+
+#include <algorithm>
+#include <atomic>
+#include <functional>
+#include <thread>
+#include <vector>
+
+// true on threads that already run alongside one per core: ParallelFor bodies and thread pool workers (see
+// ThreadPool in asset_loader.h). ParallelFor called on them runs serially rather than spawning cores² threads.
+inline bool &InParallelWork()
+{
+    static thread_local bool inside = false;
+    return inside;
+}
+
+// runs body(i) for every i in [0, count) on up to one thread per core and returns once all of them are done.
+// items are handed out one at a time, so uneven items (meshes of very different sizes) still balance.
+// nested in other parallel work it runs on the calling thread only.
+inline void ParallelFor(size_t count, const std::function<void(size_t)> &body)
+{
+    size_t threadCount = std::min<size_t>(count, std::max(1u, std::thread::hardware_concurrency()));
+    if (threadCount <= 1 || InParallelWork())
+    {
+        for (size_t i = 0; i < count; i++)
+            body(i);
+        return;
+    }
+
+    std::atomic<size_t> next(0);
+    auto work = [&]() {
+        InParallelWork() = true;
+        for (size_t i = next++; i < count; i = next++)
+            body(i);
+        InParallelWork() = false;
+    };
+    std::vector<std::thread> threads;
+    for (size_t t = 1; t < threadCount; t++)
+        threads.emplace_back(work);
+    work();
+    for (std::thread &thread: threads)
+        thread.join();
+}
+#endif
@@ -0,0 +1,180 @@
+#ifndef PIXEL_UPLOAD_RING_H
+#define PIXEL_UPLOAD_RING_H
+
+#include <glad/glad.h>
+
+#include <algorithm>
+#include <chrono>
+#include <cstring>
+#include <deque>
+#include <memory>
+
+struct PixelUploadStats {
+    size_t bytesInFlight = 0;  // staged bytes the GPU may still be reading
+    size_t bytesStaged = 0;    // total bytes that went through the ring
+    size_t uploads = 0;
+    size_t bytesBypassed = 0;  // uploads that couldn't be staged and went from client memory, should stay 0
+    size_t waits = 0;          // times staging had to block on a fence
+    float waitMs = 0.0f;       // total time spent blocked
+};
+
+// Staging ring for texture uploads: one long-lived GL_PIXEL_UNPACK_BUFFER that pixel data is copied into,
+// so glTex(Sub)Image calls source from a buffer offset and return without the driver copying client memory.
+// Each staged range is fenced after the upload that reads it; the ring only blocks when it wraps around onto
+// a range the GPU hasn't consumed yet. Ranges are mapped unsynchronized one at a time, as GL 3.3 has no
+// persistent mapping.
+// Usage, on the GL thread:
+//     const void *pixels = PixelUploadRing::Get().Stage(data, size);
+//     glTexSubImage2D(..., pixels);
+//     PixelUploadRing::Get().Submit();
+// Uploads larger than MaxStageBytes go up in bands of rows, see TextureLoader::TexImage2D.
+class PixelUploadRing
+{
+public:
+    explicit PixelUploadRing(size_t capacity = 8 << 20) : capacity(capacity)
+    {
+        glGenBuffers(1, &buffer);
+        glBindBuffer(GL_PIXEL_UNPACK_BUFFER, buffer);
+        glBufferData(GL_PIXEL_UNPACK_BUFFER, capacity, nullptr, GL_STREAM_DRAW);
+        glBindBuffer(GL_PIXEL_UNPACK_BUFFER, 0);
+    }
+
+    ~PixelUploadRing()
+    {
+        for (Region &region: inFlight)
+            glDeleteSync(region.fence);
+        glDeleteBuffers(1, &buffer);
+    }
+
+    PixelUploadRing(const PixelUploadRing &) = delete;
+    PixelUploadRing &operator=(const PixelUploadRing &) = delete;
+
+    // the shared ring, created on first use
+    static PixelUploadRing &Get()
+    {
+        std::unique_ptr<PixelUploadRing> &ring = instance();
+        if (!ring)
+            ring.reset(new PixelUploadRing());
+        return *ring;
+    }
+
+    // deletes the ring's GL objects. call before the context goes away.
+    static void Destroy()
+    {
+        instance().reset();
+    }
+
+    // the most one Stage call takes; half the ring, so one range can be filled while the GPU reads the other
+    size_t MaxStageBytes() const
+    {
+        return capacity / 2;
+    }
+
+    // copies `size` bytes, at most MaxStageBytes, into the ring and leaves it bound as the unpack buffer.
+    // returns what to pass as the pixel pointer of the following upload call: the offset into the ring, or
+    // `data` itself (with no unpack buffer bound) when the range can't be mapped or is too large.
+    const void *Stage(const void *data, size_t size)
+    {
+        retireCompleted();
+        size_t offset = head + size <= capacity ? head : 0;
+        void *mapped = nullptr;
+        if (size > 0 && size <= MaxStageBytes())
+        {
+            while (overlapsInFlight(offset, size))
+                waitOldest();
+            glBindBuffer(GL_PIXEL_UNPACK_BUFFER, buffer);
+            mapped = glMapBufferRange(GL_PIXEL_UNPACK_BUFFER, offset, size,
+                                      GL_MAP_WRITE_BIT | GL_MAP_UNSYNCHRONIZED_BIT | GL_MAP_INVALIDATE_RANGE_BIT);
+        }
+        if (!mapped)
+        {
+            stats.bytesBypassed += size;
+            glBindBuffer(GL_PIXEL_UNPACK_BUFFER, 0);
+            return data;
+        }
+        memcpy(mapped, data, size);
+        glUnmapBuffer(GL_PIXEL_UNPACK_BUFFER);
+
+        // ranges start 256-byte aligned, which satisfies any unpack alignment and block size
+        head = std::min(capacity, (offset + size + 255) & ~(size_t)255);
+        staged = Region{offset, size, 0};
+        hasStaged = true;
+        stats.bytesStaged += size;
+        stats.bytesInFlight += size;
+        stats.uploads++;
+        return (const void *)offset;
+    }
+
+    // fences the last staged range behind the upload that reads it and unbinds the unpack buffer
+    void Submit()
+    {
+        if (hasStaged)
+        {
+            staged.fence = glFenceSync(GL_SYNC_GPU_COMMANDS_COMPLETE, 0);
+            inFlight.push_back(staged);
+            hasStaged = false;
+        }
+        glBindBuffer(GL_PIXEL_UNPACK_BUFFER, 0);
+    }
+
+    PixelUploadStats Stats() const
+    {
+        return stats;
+    }
+
+private:
+    struct Region {
+        size_t offset;
+        size_t size;
+        GLsync fence;
+    };
+
+    GLuint buffer;
+    size_t capacity;
+    size_t head = 0;
+    std::deque<Region> inFlight;
+    Region staged = Region{0, 0, 0};
+    bool hasStaged = false;
+    PixelUploadStats stats;
+
+    static std::unique_ptr<PixelUploadRing> &instance()
+    {
+        static std::unique_ptr<PixelUploadRing> ring;
+        return ring;
+    }
+
+    bool overlapsInFlight(size_t offset, size_t size) const
+    {
+        for (const Region &region: inFlight)
+            if (offset < region.offset + region.size && region.offset < offset + size)
+                return true;
+        return false;
+    }
+
+    void retire()
+    {
+        glDeleteSync(inFlight.front().fence);
+        stats.bytesInFlight -= inFlight.front().size;
+        inFlight.pop_front();
+    }
+
+    // drops the ranges whose uploads are done, without blocking
+    void retireCompleted()
+    {
+        while (!inFlight.empty() && glClientWaitSync(inFlight.front().fence, 0, 0) != GL_TIMEOUT_EXPIRED)
+            retire();
+    }
+
+    void waitOldest()
+    {
+        auto start = std::chrono::steady_clock::now();
+        GLenum result;
+        do
+            result = glClientWaitSync(inFlight.front().fence, GL_SYNC_FLUSH_COMMANDS_BIT, 1000000);
+        while (result == GL_TIMEOUT_EXPIRED);
+        stats.waits++;
+        stats.waitMs += std::chrono::duration<float, std::milli>(std::chrono::steady_clock::now() - start).count();
+        retire();
+    }
+};
+#endif
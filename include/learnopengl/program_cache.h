@@ -0,0 +1,130 @@
+#ifndef PROGRAM_CACHE_H
+#define PROGRAM_CACHE_H
+
+#include <glad/glad.h>
+
+#include <learnopengl/asset_cache.h>
+#include <learnopengl/gl_ext.h>
+#include <learnopengl/hash.h>
+
+#include <cstring>
+#include <string>
+#include <vector>
+
+// Linked shader programs saved with glGetProgramBinary, so later starts skip compiling and linking GLSL.
+// One file per program next to its vertex shader: header, then the driver's binary as is. The key covers the
+// sources and the driver's vendor, renderer and version strings; drivers may still reject a binary (e.g. after an
+// update that kept the version string), in which case the program is compiled from source and the file rewritten.
+// Without program binary support (GLExtensions::programBinary) nothing is read or written.
+const uint32_t PROGRAM_CACHE_VERSION = 1;
+
+struct ProgramCacheHeader {
+    char     magic[8];
+    uint32_t version;
+    uint32_t binaryFormat;
+    uint64_t key;
+    uint64_t length;
+};
+
+// what the cache did since start, for the startup log
+struct ProgramCacheStats {
+    unsigned int hits = 0;
+    unsigned int misses = 0;
+    unsigned int rejected = 0; // binaries the driver refused, counted in misses too
+    double loadMs = 0.0;       // spent in glProgramBinary on hits
+    double compileMs = 0.0;    // from submitting the compile to the program being ready, summed over the misses
+};
+
+class ProgramCache
+{
+public:
+    // e.g. resources/shaders/skybox.vs+skybox.fs.progbin
+    static std::string PathFor(const std::string &vertexPath, const std::string &fragmentPath, const std::string &geometryPath = "")
+    {
+        std::string path = vertexPath + "+" + fragmentPath.substr(fragmentPath.find_last_of('/') + 1);
+        if (!geometryPath.empty())
+            path += "+" + geometryPath.substr(geometryPath.find_last_of('/') + 1);
+        return path + ".progbin";
+    }
+
+    // returns 0 when binaries aren't supported, in which case the cache is not used
+    static uint64_t Key(const std::vector<std::string> &sources)
+    {
+        if (!GLExtensions::Get().programBinary)
+            return 0;
+        uint64_t key = fnv1aValue(PROGRAM_CACHE_VERSION, FNV_OFFSET_BASIS);
+        for (const std::string &source: sources)
+            key = fnv1aValue((uint64_t)source.size(), fnv1a(source, key));
+        for (GLenum name: {GL_VENDOR, GL_RENDERER, GL_VERSION})
+            if (const GLubyte *value = glGetString(name))
+                key = fnv1a((const char *)value, key);
+        return key;
+    }
+
+    // loads the binary into `program` and returns whether it linked. a binary the driver rejects leaves the
+    // program unlinked; it can still get shaders attached and be linked from source.
+    static bool Load(const std::string &cachePath, uint64_t key, GLuint program)
+    {
+        MappedFile file(cachePath);
+        if (key == 0 || !file.valid() || file.length() < sizeof(ProgramCacheHeader))
+            return false;
+        ProgramCacheHeader header;
+        memcpy(&header, file.bytes(), sizeof(header));
+        if (memcmp(header.magic, magic(), sizeof(header.magic)) != 0 || header.version != PROGRAM_CACHE_VERSION ||
+            header.key != key || sizeof(header) + header.length > file.length())
+            return false;
+
+        GLExtensions::Get().ProgramBinary(program, header.binaryFormat, file.bytes() + sizeof(header), (GLsizei)header.length);
+        GLint linked = GL_FALSE;
+        glGetProgramiv(program, GL_LINK_STATUS, &linked);
+        if (!linked)
+            Stats().rejected++;
+        return linked == GL_TRUE;
+    }
+
+    // call before linking a program that is going to be stored, some drivers only keep the binary when asked to
+    static void MarkRetrievable(GLuint program)
+    {
+        if (GLExtensions::Get().programBinary)
+            GLExtensions::Get().ProgramParameteri(program, GL_PROGRAM_BINARY_RETRIEVABLE_HINT, GL_TRUE);
+    }
+
+    static bool Store(const std::string &cachePath, uint64_t key, GLuint program)
+    {
+        if (key == 0)
+            return false;
+        GLint length = 0;
+        glGetProgramiv(program, GL_PROGRAM_BINARY_LENGTH, &length);
+        if (length <= 0)
+            return false;
+
+        ProgramCacheHeader header;
+        memcpy(header.magic, magic(), sizeof(header.magic));
+        header.version = PROGRAM_CACHE_VERSION;
+        header.key = key;
+        std::string blob(sizeof(header) + length, '\0');
+        GLenum format = 0;
+        GLsizei written = 0;
+        GLExtensions::Get().GetProgramBinary(program, length, &written, &format, &blob[sizeof(header)]);
+        if (written <= 0)
+            return false;
+        header.binaryFormat = format;
+        header.length = written;
+        memcpy(&blob[0], &header, sizeof(header));
+        blob.resize(sizeof(header) + written);
+        return AssetCache::WriteFile(cachePath, blob);
+    }
+
+    static ProgramCacheStats &Stats()
+    {
+        static ProgramCacheStats stats;
+        return stats;
+    }
+
+private:
+    static const char *magic()
+    {
+        return "LOGLPRG";
+    }
+};
+#endif
@@ -0,0 +1,561 @@
+#ifndef PROGRAM_REGISTRY_H
+#define PROGRAM_REGISTRY_H
+
+#include <glad/glad.h>
+
+#include <learnopengl/gl_ext.h>
+#include <learnopengl/gl_state.h>
+#include <learnopengl/hash.h>
+#include <learnopengl/program_cache.h>
+#include <learnopengl/shader_compiler.h>
+
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <cstring>
+#include <iostream>
+#include <memory>
+#include <string>
+#include <thread>
+#include <unordered_map>
+#include <vector>
+
+// A uniform's name by its FNV-1a hash. The constructor is constexpr, so names given as literals hash at compile
+// time; Append extends a name without building the string (e.g. a texture number or an array index).
+struct UniformName {
+    uint64_t hash;
+
+    constexpr UniformName(const char *name) : hash(fnv1a(name)) {}
+    UniformName(const std::string &name) : hash(fnv1a(name)) {}
+
+    UniformName Append(const char *suffix) const
+    {
+        return Hashed(fnv1a(suffix, hash));
+    }
+
+    UniformName Append(const std::string &suffix) const
+    {
+        return Hashed(fnv1a(suffix, hash));
+    }
+
+    // appends the decimal digits of `number`
+    UniformName Append(unsigned int number) const
+    {
+        char digits[10];
+        int count = 0;
+        do
+        {
+            digits[count++] = (char)('0' + number % 10);
+            number /= 10;
+        } while (number);
+        uint64_t extended = hash;
+        while (count)
+        {
+            extended ^= (unsigned char)digits[--count];
+            extended *= FNV_PRIME;
+        }
+        return Hashed(extended);
+    }
+
+    static UniformName Hashed(uint64_t hash)
+    {
+        UniformName name("");
+        name.hash = hash;
+        return name;
+    }
+};
+
+// one uniform's value as glUniform* takes it
+struct UniformValue {
+    enum Kind { Int, Float, Vec2, Vec3, Vec4, Mat2, Mat3, Mat4, None };
+    Kind kind = None; // None: no value yet
+    union {
+        GLint i;
+        GLfloat f[16];
+    };
+
+    UniformValue() : f() {}
+
+    static UniformValue Ints(GLint value)
+    {
+        UniformValue v;
+        v.kind = Int;
+        v.i = value;
+        return v;
+    }
+
+    static UniformValue Floats(Kind kind, const GLfloat *values)
+    {
+        UniformValue v;
+        v.kind = kind;
+        memcpy(v.f, values, Size(kind) * sizeof(GLfloat));
+        return v;
+    }
+
+    static int Size(Kind kind)
+    {
+        static const int sizes[] = {1, 1, 2, 3, 4, 4, 9, 16, 0};
+        return sizes[kind];
+    }
+
+    bool operator==(const UniformValue &other) const
+    {
+        return kind == other.kind && memcmp(f, other.f, Size(kind) * sizeof(GLfloat)) == 0;
+    }
+
+    // uploads to `location` of the bound program
+    void Upload(GLint location) const
+    {
+        switch (kind)
+        {
+        case Int: glUniform1i(location, i); break;
+        case Float: glUniform1f(location, f[0]); break;
+        case Vec2: glUniform2fv(location, 1, f); break;
+        case Vec3: glUniform3fv(location, 1, f); break;
+        case Vec4: glUniform4fv(location, 1, f); break;
+        case Mat2: glUniformMatrix2fv(location, 1, GL_FALSE, f); break;
+        case Mat3: glUniformMatrix3fv(location, 1, GL_FALSE, f); break;
+        case Mat4: glUniformMatrix4fv(location, 1, GL_FALSE, f); break;
+        case None: break;
+        }
+    }
+};
+
+// what the shared programs did; the per-frame counters are cleared by ResetFrame
+struct ProgramStats {
+    unsigned int programs = 0;   // distinct programs loaded or compiled
+    unsigned int instances = 0;  // Shader objects using them
+    size_t programBytes = 0;     // driver binaries of the programs, where the driver tells (program binaries)
+    size_t binds = 0;            // glUseProgram calls
+    size_t bindsSkipped = 0;     // use() of the program already bound
+    size_t uniformUploads = 0;   // glUniform* calls
+    size_t uniformsSkipped = 0;  // values the program already held
+    size_t unknownUniforms = 0;  // set* of names the program has no (active) uniform for
+
+    void ResetFrame()
+    {
+        binds = bindsSkipped = uniformUploads = uniformsSkipped = unknownUniforms = 0;
+    }
+};
+
+// A linked GL program shared by every Shader built from the same sources. It builds in two phases: Submit starts
+// the compile and link and returns right away, Ready() polls and finishes the program (error checks, program
+// cache) once it linked. Where the driver has KHR_parallel_shader_compile its threads do the work, else a running
+// ShaderCompiler does; without either Submit compiles in place and Ready() blocks on the driver.
+// Once linked, the program's active uniforms are listed into slots, one per location, with their names sorted by
+// hash, so uniforms are found by their UniformName without querying GL. Each slot keeps the value the program
+// linked with, which Shaders fall back to for uniforms they never set. The program also remembers which Shader's
+// uniform values it holds, and what it holds in each slot.
+class ShaderProgram
+{
+public:
+    GLuint id = 0;
+    const void *owner = nullptr; // the Shader whose uniform values were last synced into the program
+
+    ShaderProgram() = default;
+    ShaderProgram(const ShaderProgram &) = delete;
+    ShaderProgram &operator=(const ShaderProgram &) = delete;
+
+    ~ShaderProgram()
+    {
+        Delete();
+    }
+
+    // deletes the GL program. the destructor does too, but Shaders outliving the context (locals of main)
+    // need ProgramRegistry::DeleteAll before it goes away.
+    void Delete()
+    {
+        if (!id)
+            return;
+        // a new program may get the same name
+        if (GLState::IsProgram(id))
+            GLState::InvalidateProgram();
+        glDeleteProgram(id);
+        id = 0;
+    }
+
+    // loads the program from the program cache or submits its compile
+    void Submit(const std::string &vertexPath, const std::string &fragmentPath, const std::string &geometryPath,
+                const std::string &vertexCode, const std::string &fragmentCode, const std::string &geometryCode)
+    {
+        auto start = std::chrono::steady_clock::now();
+        std::string cachePath = ProgramCache::PathFor(vertexPath, fragmentPath, geometryPath);
+        uint64_t cacheKey = ProgramCache::Key({vertexCode, fragmentCode, geometryCode});
+        id = glCreateProgram();
+        if (ProgramCache::Load(cachePath, cacheKey, id))
+        {
+            ProgramCache::Stats().hits++;
+            ProgramCache::Stats().loadMs += std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - start).count();
+            linked();
+            return;
+        }
+        pending = std::make_shared<PendingProgram>();
+        pending->cachePath = cachePath;
+        pending->cacheKey = cacheKey;
+        pending->start = start;
+        if (ShaderCompiler::Running())
+        {
+            pending->onWorker = true;
+            GLuint program = id;
+            std::shared_ptr<PendingProgram> job = pending;
+            ShaderCompiler::Submit([program, job, vertexCode, fragmentCode, geometryCode]() {
+                compile(program, vertexCode, fragmentCode, geometryCode, job->stages);
+                // the program is only safe to use from the main context once the worker's commands completed
+                glFinish();
+                job->done = true;
+            });
+        }
+        else
+            compile(id, vertexCode, fragmentCode, geometryCode, pending->stages);
+    }
+
+    // true once the program is linked and usable. finishes it the first time that's the case.
+    bool Ready()
+    {
+        if (!pending)
+            return true;
+        if (pending->onWorker && !pending->done)
+            return false;
+        if (!pending->onWorker && GLExtensions::Get().parallelShaderCompile)
+        {
+            GLint complete = GL_FALSE;
+            glGetProgramiv(id, GL_COMPLETION_STATUS_KHR, &complete);
+            if (!complete)
+                return false;
+        }
+        finish();
+        return true;
+    }
+
+    void Wait()
+    {
+        while (!Ready())
+            std::this_thread::sleep_for(std::chrono::microseconds(200));
+    }
+
+    bool Pending() const
+    {
+        return pending != nullptr;
+    }
+
+    // glUseProgram unless the program already is in use, see GLState. code using programs behind its back has
+    // to call InvalidateBinding afterwards.
+    void Bind()
+    {
+        if (GLState::UseProgram(id))
+            Stats().binds++;
+        else
+            Stats().bindsSkipped++;
+    }
+
+    bool IsBound() const
+    {
+        return GLState::IsProgram(id);
+    }
+
+    // the slot of an active uniform, or -1. the program has to be linked.
+    int Slot(UniformName name) const
+    {
+        auto entry = std::lower_bound(names.begin(), names.end(), name.hash,
+                                      [](const UniformEntry &entry, uint64_t hash) { return entry.hash < hash; });
+        return entry != names.end() && entry->hash == name.hash ? entry->slot : -1;
+    }
+
+    size_t SlotCount() const
+    {
+        return locations.size();
+    }
+
+    // the value the slot had right after linking; kind None for types UniformValue can't hold
+    const UniformValue &Default(int slot) const
+    {
+        return defaults[slot];
+    }
+
+    // uploads a value unless the program already holds it. the program has to be bound.
+    void Upload(int slot, const UniformValue &value)
+    {
+        if (values[slot] == value)
+        {
+            Stats().uniformsSkipped++;
+            return;
+        }
+        value.Upload(locations[slot]);
+        values[slot] = value;
+        Stats().uniformUploads++;
+    }
+
+    static void InvalidateBinding()
+    {
+        GLState::InvalidateProgram();
+    }
+
+    static ProgramStats &Stats()
+    {
+        static ProgramStats stats;
+        return stats;
+    }
+
+private:
+    // a program whose compile and link were submitted but not yet checked
+    struct PendingProgram {
+        std::string cachePath;
+        uint64_t cacheKey = 0;
+        std::chrono::steady_clock::time_point start;
+        GLuint stages[3] = {0, 0, 0}; // vertex, fragment, geometry
+        bool onWorker = false;
+        std::atomic<bool> done{false}; // set by the ShaderCompiler once the link completed
+    };
+    struct UniformEntry {
+        uint64_t hash;
+        int slot;
+    };
+    std::shared_ptr<PendingProgram> pending;
+    std::vector<UniformEntry> names;     // sorted by hash; several names can share a slot ("x" and "x[0]")
+    std::vector<GLint> locations;        // per slot
+    std::vector<UniformValue> defaults;  // per slot, as linked
+    std::vector<UniformValue> values;    // what the program holds, per slot
+
+    // compiles the stages and links them into `program` without waiting for either, the geometry stage only if
+    // there is code for it. no status is queried here, that would block until the driver is done.
+    static void compile(GLuint program, const std::string &vertexCode, const std::string &fragmentCode,
+                        const std::string &geometryCode, GLuint stages[3])
+    {
+        const char* vShaderCode = vertexCode.c_str();
+        const char * fShaderCode = fragmentCode.c_str();
+        // vertex shader
+        stages[0] = glCreateShader(GL_VERTEX_SHADER);
+        glShaderSource(stages[0], 1, &vShaderCode, NULL);
+        glCompileShader(stages[0]);
+        // fragment Shader
+        stages[1] = glCreateShader(GL_FRAGMENT_SHADER);
+        glShaderSource(stages[1], 1, &fShaderCode, NULL);
+        glCompileShader(stages[1]);
+        // if geometry shader is given, compile geometry shader
+        if(!geometryCode.empty())
+        {
+            const char * gShaderCode = geometryCode.c_str();
+            stages[2] = glCreateShader(GL_GEOMETRY_SHADER);
+            glShaderSource(stages[2], 1, &gShaderCode, NULL);
+            glCompileShader(stages[2]);
+        }
+        // shader Program
+        for (int i = 0; i < 3; i++)
+            if (stages[i])
+                glAttachShader(program, stages[i]);
+        ProgramCache::MarkRetrievable(program);
+        glLinkProgram(program);
+    }
+
+    // checks the compile and link results, frees the stages and stores the linked program in the cache
+    void finish()
+    {
+        static const char *stageNames[3] = {"VERTEX", "FRAGMENT", "GEOMETRY"};
+        for (int i = 0; i < 3; i++)
+            if (pending->stages[i])
+                checkCompileErrors(pending->stages[i], stageNames[i]);
+        bool success = checkCompileErrors(id, "PROGRAM");
+        // delete the shaders as they're linked into our program now and no longer necessery
+        for (int i = 0; i < 3; i++)
+            if (pending->stages[i])
+            {
+                glDetachShader(id, pending->stages[i]);
+                glDeleteShader(pending->stages[i]);
+            }
+        if (success && pending->cacheKey != 0 && !ProgramCache::Store(pending->cachePath, pending->cacheKey, id))
+            std::cout << "WARNING::PROGRAM_CACHE:: could not write " << pending->cachePath << std::endl;
+        ProgramCacheStats &stats = ProgramCache::Stats();
+        stats.misses++;
+        stats.compileMs += std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - pending->start).count();
+        pending.reset();
+        linked();
+    }
+
+    void linked()
+    {
+        listUniforms();
+        if (!GLExtensions::Get().programBinary)
+            return;
+        GLint length = 0;
+        glGetProgramiv(id, GL_PROGRAM_BINARY_LENGTH, &length);
+        Stats().programBytes += length;
+    }
+
+    // one slot per active uniform outside of uniform blocks. arrays of plain types are reported as "name[0]";
+    // they get a slot per element, and the bare name stands for the first one.
+    void listUniforms()
+    {
+        GLint count = 0, maxLength = 0;
+        glGetProgramiv(id, GL_ACTIVE_UNIFORMS, &count);
+        glGetProgramiv(id, GL_ACTIVE_UNIFORM_MAX_LENGTH, &maxLength);
+        std::vector<GLchar> name(std::max(maxLength, 1));
+        for (GLint i = 0; i < count; i++)
+        {
+            GLint size = 0;
+            GLenum type = 0;
+            glGetActiveUniform(id, (GLuint)i, (GLsizei)name.size(), nullptr, &size, &type, name.data());
+            GLint location = glGetUniformLocation(id, name.data());
+            if (location < 0)
+                continue;
+            std::string uniform = name.data();
+            names.push_back({fnv1a(uniform), addSlot(location, type)});
+            size_t bracket = uniform.rfind("[0]");
+            if (bracket == std::string::npos || bracket + 3 != uniform.size())
+                continue;
+            UniformName base(uniform.substr(0, bracket));
+            names.push_back({base.hash, names.back().slot});
+            for (GLint element = 1; element < size; element++)
+            {
+                GLint elementLocation = glGetUniformLocation(id, (uniform.substr(0, bracket) + "[" + std::to_string(element) + "]").c_str());
+                if (elementLocation >= 0)
+                    names.push_back({base.Append("[").Append((unsigned int)element).Append("]").hash, addSlot(elementLocation, type)});
+            }
+        }
+        std::sort(names.begin(), names.end(), [](const UniformEntry &a, const UniformEntry &b) { return a.hash < b.hash; });
+        values = defaults;
+    }
+
+    // adds a slot for `location`, reading the value it linked with
+    int addSlot(GLint location, GLenum type)
+    {
+        UniformValue value;
+        switch (type)
+        {
+        case GL_FLOAT: value.kind = UniformValue::Float; break;
+        case GL_FLOAT_VEC2: value.kind = UniformValue::Vec2; break;
+        case GL_FLOAT_VEC3: value.kind = UniformValue::Vec3; break;
+        case GL_FLOAT_VEC4: value.kind = UniformValue::Vec4; break;
+        case GL_FLOAT_MAT2: value.kind = UniformValue::Mat2; break;
+        case GL_FLOAT_MAT3: value.kind = UniformValue::Mat3; break;
+        case GL_FLOAT_MAT4: value.kind = UniformValue::Mat4; break;
+        case GL_INT: case GL_BOOL:
+        case GL_SAMPLER_2D: case GL_SAMPLER_3D: case GL_SAMPLER_CUBE: case GL_SAMPLER_2D_SHADOW:
+        case GL_SAMPLER_2D_ARRAY: value.kind = UniformValue::Int; break;
+        default: break;
+        }
+        if (value.kind == UniformValue::Int)
+            glGetUniformiv(id, location, &value.i);
+        else if (value.kind != UniformValue::None)
+            glGetUniformfv(id, location, value.f);
+        locations.push_back(location);
+        defaults.push_back(value);
+        return (int)locations.size() - 1;
+    }
+
+    // utility function for checking shader compilation/linking errors, returns whether there were none.
+    // ------------------------------------------------------------------------
+    static bool checkCompileErrors(GLuint shader, std::string type)
+    {
+        GLint success;
+        GLchar infoLog[1024];
+        if(type != "PROGRAM")
+        {
+            glGetShaderiv(shader, GL_COMPILE_STATUS, &success);
+            if(!success)
+            {
+                glGetShaderInfoLog(shader, 1024, NULL, infoLog);
+                std::cout << "ERROR::SHADER_COMPILATION_ERROR of type: " << type << "\n" << infoLog << "\n -- --------------------------------------------------- -- " << std::endl;
+            }
+        }
+        else
+        {
+            glGetProgramiv(shader, GL_LINK_STATUS, &success);
+            if(!success)
+            {
+                glGetProgramInfoLog(shader, 1024, NULL, infoLog);
+                std::cout << "ERROR::PROGRAM_LINKING_ERROR of type: " << type << "\n" << infoLog << "\n -- --------------------------------------------------- -- " << std::endl;
+            }
+        }
+        return success == GL_TRUE;
+    }
+};
+
+// Deduplicates programs: Shaders whose sources only differ in comments and whitespace share one ShaderProgram.
+// Entries are weak, a program goes once the last Shader using it does.
+class ProgramRegistry
+{
+public:
+    // key over the normalized sources, see Normalize
+    static uint64_t Key(const std::vector<std::string> &sources)
+    {
+        uint64_t key = FNV_OFFSET_BASIS;
+        for (const std::string &source: sources)
+        {
+            std::string normalized = Normalize(source);
+            key = fnv1aValue((uint64_t)normalized.size(), fnv1a(normalized, key));
+        }
+        return key;
+    }
+
+    static std::shared_ptr<ShaderProgram> Find(uint64_t key)
+    {
+        auto entry = programs().find(key);
+        return entry != programs().end() ? entry->second.lock() : nullptr;
+    }
+
+    static void Insert(uint64_t key, const std::shared_ptr<ShaderProgram> &program)
+    {
+        programs()[key] = program;
+        ShaderProgram::Stats().programs++;
+    }
+
+    // deletes the GL programs still in use, call before the context goes away
+    static void DeleteAll()
+    {
+        for (auto &entry: programs())
+            if (std::shared_ptr<ShaderProgram> program = entry.second.lock())
+                program->Delete();
+        programs().clear();
+    }
+
+    // GLSL with comments removed, every line trimmed, runs of blanks collapsed and empty lines dropped.
+    // line breaks stay, preprocessor directives end with them.
+    static std::string Normalize(const std::string &source)
+    {
+        std::string out;
+        out.reserve(source.size());
+        bool blank = false;
+        for (size_t i = 0; i < source.size(); i++)
+        {
+            char c = source[i];
+            if (c == '/' && i + 1 < source.size() && source[i + 1] == '/')
+            {
+                while (i + 1 < source.size() && source[i + 1] != '\n')
+                    i++;
+                continue;
+            }
+            if (c == '/' && i + 1 < source.size() && source[i + 1] == '*')
+            {
+                size_t end = source.find("*/", i + 2);
+                i = end == std::string::npos ? source.size() : end + 1;
+                blank = true; // a comment separates tokens like a blank does
+                continue;
+            }
+            if (c == ' ' || c == '\t' || c == '\r')
+            {
+                blank = true;
+                continue;
+            }
+            if (c == '\n')
+            {
+                if (!out.empty() && out.back() != '\n')
+                    out += '\n';
+                blank = false;
+                continue;
+            }
+            if (blank && !out.empty() && out.back() != '\n')
+                out += ' ';
+            blank = false;
+            out += c;
+        }
+        return out;
+    }
+
+private:
+    static std::unordered_map<uint64_t, std::weak_ptr<ShaderProgram>> &programs()
+    {
+        static std::unordered_map<uint64_t, std::weak_ptr<ShaderProgram>> registry;
+        return registry;
+    }
+};
+#endif
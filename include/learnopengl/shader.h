@@ -4,16 +4,26 @@
 #include <glad/glad.h>
 #include <glm/glm.hpp>
 
+#include <learnopengl/program_registry.h>
+
+#include <memory>
 #include <string>
+#include <vector>
 #include <fstream>
 #include <sstream>
 #include <iostream>
 #include <common.h>
+// A program as the render code sees it. Shaders built from the same sources (up to comments and whitespace) share
+// one ShaderProgram, see ProgramRegistry, but each keeps its own uniform values: set* records them and they reach the
+// program right away when this Shader is the one in use, otherwise at its next use(). Programs compile in the
+// background, see ShaderProgram; use() waits for the program if needed.
+// Uniforms are named by UniformName, literals hash at compile time and resolve to the program's slots without
+// querying GL, so setting uniforms doesn't allocate once each name was set the first time.
 class Shader
 {
 public:
     unsigned int ID;
-    // constructor generates the shader on the fly
+    // constructor submits the shader program, see Ready
     // ------------------------------------------------------------------------
     Shader(const char* vertexPath, const char* fragmentPath, const char* geometryPath = nullptr)
     {
@@ -51,8 +61,6 @@ public:
             // if geometry shader path is present, also load a geometry shader
             if(geometryPath != nullptr)
             {
-                std::string geometryPathString(geometryPath);
-                geometryPath = geometryPathString.c_str();
                 gShaderFile.open(geometryPath);
                 std::stringstream gShaderStream;
                 gShaderStream << gShaderFile.rdbuf();
@@ -64,135 +72,139 @@ public:
         {
             std::cout << "ERROR::SHADER::FILE_NOT_SUCCESFULLY_READ" << std::endl;
         }
-        const char* vShaderCode = vertexCode.c_str();
-        const char * fShaderCode = fragmentCode.c_str();
-        // 2. compile shaders
-        unsigned int vertex, fragment;
-        // vertex shader
-        vertex = glCreateShader(GL_VERTEX_SHADER);
-        glShaderSource(vertex, 1, &vShaderCode, NULL);
-        glCompileShader(vertex);
-        checkCompileErrors(vertex, "VERTEX");
-        // fragment Shader
-        fragment = glCreateShader(GL_FRAGMENT_SHADER);
-        glShaderSource(fragment, 1, &fShaderCode, NULL);
-        glCompileShader(fragment);
-        checkCompileErrors(fragment, "FRAGMENT");
-        // if geometry shader is given, compile geometry shader
-        unsigned int geometry;
-        if(geometryPath != nullptr)
+        // 2. share the program of an earlier Shader with the same sources, or load/compile it
+        uint64_t key = ProgramRegistry::Key({vertexCode, fragmentCode, geometryCode});
+        program = ProgramRegistry::Find(key);
+        if (!program)
         {
-            const char * gShaderCode = geometryCode.c_str();
-            geometry = glCreateShader(GL_GEOMETRY_SHADER);
-            glShaderSource(geometry, 1, &gShaderCode, NULL);
-            glCompileShader(geometry);
-            checkCompileErrors(geometry, "GEOMETRY");
+            program = std::make_shared<ShaderProgram>();
+            program->Submit(vertexPath, fragmentPath, geometryPath ? geometryPath : "", vertexCode, fragmentCode, geometryCode);
+            ProgramRegistry::Insert(key, program);
         }
-        // shader Program
-        ID = glCreateProgram();
-        glAttachShader(ID, vertex);
-        glAttachShader(ID, fragment);
-        if(geometryPath != nullptr)
-            glAttachShader(ID, geometry);
-        glLinkProgram(ID);
-        checkCompileErrors(ID, "PROGRAM");
-        // delete the shaders as they're linked into our program now and no longer necessery
-        glDeleteShader(vertex);
-        glDeleteShader(fragment);
-        if(geometryPath != nullptr)
-            glDeleteShader(geometry);
+        ID = program->id;
+        ShaderProgram::Stats().instances++;
+    }
+
+    // true once the program is linked and usable, see ShaderProgram::Ready
+    bool Ready()
+    {
+        return program->Ready();
+    }
 
+    void Wait()
+    {
+        program->Wait();
     }
     // activate the shader
     // ------------------------------------------------------------------------
     void use() 
     { 
-        glUseProgram(ID); 
+        if (program->Pending())
+            program->Wait();
+        program->Bind();
+        // the program may hold another Shader's values, or miss ones set while it wasn't in use. after another
+        // Shader, the uniforms this one never set go back to the program's defaults.
+        if (program->owner != this)
+        {
+            for (size_t slot = 0; slot < program->SlotCount(); slot++)
+            {
+                const UniformValue &value = slot < values.size() && values[slot].kind != UniformValue::None ?
+                                            values[slot] : program->Default((int)slot);
+                if (value.kind != UniformValue::None)
+                    program->Upload((int)slot, value);
+            }
+            program->owner = this;
+        }
+        else if (stale)
+        {
+            for (size_t slot = 0; slot < values.size(); slot++)
+                if (values[slot].kind != UniformValue::None)
+                    program->Upload((int)slot, values[slot]);
+        }
+        stale = false;
     }
     // utility uniform functions
     // ------------------------------------------------------------------------
-    void setBool(const std::string &name, bool value) const
+    void setBool(UniformName name, bool value)
     {         
-        glUniform1i(glGetUniformLocation(ID, name.c_str()), (int)value); 
+        set(name, UniformValue::Ints((int)value)); 
     }
     // ------------------------------------------------------------------------
-    void setInt(const std::string &name, int value) const
+    void setInt(UniformName name, int value)
     { 
-        glUniform1i(glGetUniformLocation(ID, name.c_str()), value); 
+        set(name, UniformValue::Ints(value)); 
     }
     // ------------------------------------------------------------------------
-    void setFloat(const std::string &name, float value) const
+    void setFloat(UniformName name, float value)
     { 
-        glUniform1f(glGetUniformLocation(ID, name.c_str()), value); 
+        set(name, UniformValue::Floats(UniformValue::Float, &value)); 
     }
     // ------------------------------------------------------------------------
-    void setVec2(const std::string &name, const glm::vec2 &value) const
+    void setVec2(UniformName name, const glm::vec2 &value)
     { 
-        glUniform2fv(glGetUniformLocation(ID, name.c_str()), 1, &value[0]); 
+        set(name, UniformValue::Floats(UniformValue::Vec2, &value[0])); 
     }
-    void setVec2(const std::string &name, float x, float y) const
+    void setVec2(UniformName name, float x, float y)
     { 
-        glUniform2f(glGetUniformLocation(ID, name.c_str()), x, y); 
+        setVec2(name, glm::vec2(x, y)); 
     }
     // ------------------------------------------------------------------------
-    void setVec3(const std::string &name, const glm::vec3 &value) const
+    void setVec3(UniformName name, const glm::vec3 &value)
     { 
-        glUniform3fv(glGetUniformLocation(ID, name.c_str()), 1, &value[0]); 
+        set(name, UniformValue::Floats(UniformValue::Vec3, &value[0])); 
     }
-    void setVec3(const std::string &name, float x, float y, float z) const
+    void setVec3(UniformName name, float x, float y, float z)
     { 
-        glUniform3f(glGetUniformLocation(ID, name.c_str()), x, y, z); 
+        setVec3(name, glm::vec3(x, y, z)); 
     }
     // ------------------------------------------------------------------------
-    void setVec4(const std::string &name, const glm::vec4 &value) const
+    void setVec4(UniformName name, const glm::vec4 &value)
     { 
-        glUniform4fv(glGetUniformLocation(ID, name.c_str()), 1, &value[0]); 
+        set(name, UniformValue::Floats(UniformValue::Vec4, &value[0])); 
     }
-    void setVec4(const std::string &name, float x, float y, float z, float w) 
+    void setVec4(UniformName name, float x, float y, float z, float w) 
     { 
-        glUniform4f(glGetUniformLocation(ID, name.c_str()), x, y, z, w); 
+        setVec4(name, glm::vec4(x, y, z, w)); 
     }
     // ------------------------------------------------------------------------
-    void setMat2(const std::string &name, const glm::mat2 &mat) const
+    void setMat2(UniformName name, const glm::mat2 &mat)
     {
-        glUniformMatrix2fv(glGetUniformLocation(ID, name.c_str()), 1, GL_FALSE, &mat[0][0]);
+        set(name, UniformValue::Floats(UniformValue::Mat2, &mat[0][0]));
     }
     // ------------------------------------------------------------------------
-    void setMat3(const std::string &name, const glm::mat3 &mat) const
+    void setMat3(UniformName name, const glm::mat3 &mat)
     {
-        glUniformMatrix3fv(glGetUniformLocation(ID, name.c_str()), 1, GL_FALSE, &mat[0][0]);
+        set(name, UniformValue::Floats(UniformValue::Mat3, &mat[0][0]));
     }
     // ------------------------------------------------------------------------
-    void setMat4(const std::string &name, const glm::mat4 &mat) const
+    void setMat4(UniformName name, const glm::mat4 &mat)
     {
-        glUniformMatrix4fv(glGetUniformLocation(ID, name.c_str()), 1, GL_FALSE, &mat[0][0]);
+        set(name, UniformValue::Floats(UniformValue::Mat4, &mat[0][0]));
     }
 
 private:
-    // utility function for checking shader compilation/linking errors.
-    // ------------------------------------------------------------------------
-    void checkCompileErrors(GLuint shader, std::string type)
+    std::shared_ptr<ShaderProgram> program;
+    std::vector<UniformValue> values; // this Shader's values, per program slot
+    bool stale = false;               // values were set while the program wasn't ours and bound
+
+    void set(UniformName name, const UniformValue &value)
     {
-        GLint success;
-        GLchar infoLog[1024];
-        if(type != "PROGRAM")
+        // slots are only known once the program linked
+        if (program->Pending())
+            program->Wait();
+        int slot = program->Slot(name);
+        if (slot < 0)
         {
-            glGetShaderiv(shader, GL_COMPILE_STATUS, &success);
-            if(!success)
-            {
-                glGetShaderInfoLog(shader, 1024, NULL, infoLog);
-                std::cout << "ERROR::SHADER_COMPILATION_ERROR of type: " << type << "\n" << infoLog << "\n -- --------------------------------------------------- -- " << std::endl;
-            }
+            ShaderProgram::Stats().unknownUniforms++;
+            return;
         }
+        if (values.empty())
+            values.resize(program->SlotCount());
+        values[slot] = value;
+        if (program->owner == this && program->IsBound())
+            program->Upload(slot, value);
         else
-        {
-            glGetProgramiv(shader, GL_LINK_STATUS, &success);
-            if(!success)
-            {
-                glGetProgramInfoLog(shader, 1024, NULL, infoLog);
-                std::cout << "ERROR::PROGRAM_LINKING_ERROR of type: " << type << "\n" << infoLog << "\n -- --------------------------------------------------- -- " << std::endl;
-            }
-        }
+            stale = true;
     }
 };
 #endif
@@ -0,0 +1,88 @@
+#ifndef SHADER_COMPILER_H
+#define SHADER_COMPILER_H
+
+#include <condition_variable>
+#include <deque>
+#include <functional>
+#include <mutex>
+#include <thread>
+
+// Background shader compiles for drivers without KHR_parallel_shader_compile: one thread that owns a hidden GL
+// context sharing objects with the main one. Shader hands it the compile and link of a program and polls for the
+// result, so the GL thread keeps uploading assets meanwhile. Jobs run in submission order.
+class ShaderCompiler
+{
+public:
+    // makeCurrent(true) is called on the worker before the first job, makeCurrent(false) after the last one;
+    // it binds and releases the shared context (e.g. with glfwMakeContextCurrent)
+    static void Start(std::function<void(bool)> makeCurrent)
+    {
+        State &s = state();
+        if (s.worker.joinable())
+            return;
+        s.stopping = false;
+        s.worker = std::thread([makeCurrent]() {
+            makeCurrent(true);
+            State &s = state();
+            for (;;)
+            {
+                std::function<void()> job;
+                {
+                    std::unique_lock<std::mutex> lock(s.mutex);
+                    s.wakeup.wait(lock, [&s]() { return s.stopping || !s.jobs.empty(); });
+                    if (s.jobs.empty())
+                        break;
+                    job = std::move(s.jobs.front());
+                    s.jobs.pop_front();
+                }
+                job();
+            }
+            makeCurrent(false);
+        });
+    }
+
+    // runs the queued jobs, then releases the context and joins the worker
+    static void Stop()
+    {
+        State &s = state();
+        if (!s.worker.joinable())
+            return;
+        {
+            std::lock_guard<std::mutex> lock(s.mutex);
+            s.stopping = true;
+        }
+        s.wakeup.notify_one();
+        s.worker.join();
+    }
+
+    static bool Running()
+    {
+        return state().worker.joinable();
+    }
+
+    static void Submit(std::function<void()> job)
+    {
+        State &s = state();
+        {
+            std::lock_guard<std::mutex> lock(s.mutex);
+            s.jobs.push_back(std::move(job));
+        }
+        s.wakeup.notify_one();
+    }
+
+private:
+    struct State {
+        std::thread worker;
+        std::deque<std::function<void()>> jobs;
+        std::mutex mutex;
+        std::condition_variable wakeup;
+        bool stopping = false;
+    };
+
+    static State &state()
+    {
+        static State s;
+        return s;
+    }
+};
+#endif
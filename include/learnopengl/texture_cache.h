@@ -0,0 +1,159 @@
+#ifndef TEXTURE_CACHE_H
+#define TEXTURE_CACHE_H
+
+#include <learnopengl/asset_cache.h>
+#include <learnopengl/texture_compressor.h>
+
+#include <cstring>
+#include <memory>
+#include <string>
+#include <vector>
+
+// KTX-like container for a block-compressed mip chain: header, level table, then 16-byte aligned level data.
+// Written next to the source image on first load and uploaded directly on every later one.
+// Bump TEXTURE_CACHE_VERSION whenever the layout or the encoder output changes.
+const uint32_t TEXTURE_CACHE_VERSION = 1;
+
+struct TextureCacheHeader {
+    char     magic[8];
+    uint32_t version;
+    uint32_t internalFormat;
+    uint64_t key;
+    uint32_t width;
+    uint32_t height;
+    uint32_t components;
+    uint32_t levelCount;
+};
+
+struct TextureCacheLevel {
+    uint32_t width;
+    uint32_t height;
+    uint64_t offset;
+    uint64_t size;
+};
+
+// a block-compressed mip chain, backed either by a mapping of the cache file or by freshly encoded blocks
+struct CompressedTexture {
+    GLenum internalFormat = 0;
+    std::vector<TextureCacheLevel> levels;
+    std::shared_ptr<MappedFile> mapping;
+    std::vector<unsigned char> blocks;
+
+    const unsigned char *LevelData(size_t level) const
+    {
+        return (mapping ? mapping->bytes() : blocks.data()) + levels[level].offset;
+    }
+};
+
+class TextureCache
+{
+public:
+    static std::string PathFor(const std::string &imagePath)
+    {
+        return imagePath + ".ctex";
+    }
+
+    static uint64_t Key(const std::string &imagePath)
+    {
+        uint64_t key = AssetCache::HashFile(imagePath);
+        if (key == 0)
+            return 0;
+        return fnv1aValue(TEXTURE_CACHE_VERSION, key);
+    }
+
+    static bool Load(const std::string &cachePath, uint64_t key, CompressedTexture &texture, int &width, int &height, int &components)
+    {
+        std::shared_ptr<MappedFile> file = std::make_shared<MappedFile>(cachePath);
+        if (!file->valid() || file->length() < sizeof(TextureCacheHeader))
+            return false;
+
+        TextureCacheHeader header;
+        memcpy(&header, file->bytes(), sizeof(header));
+        if (memcmp(header.magic, magic(), sizeof(header.magic)) != 0 || header.version != TEXTURE_CACHE_VERSION ||
+            header.key != key || header.levelCount == 0 ||
+            sizeof(TextureCacheHeader) + header.levelCount * sizeof(TextureCacheLevel) > file->length())
+            return false;
+
+        std::vector<TextureCacheLevel> levels(header.levelCount);
+        memcpy(levels.data(), file->bytes() + sizeof(TextureCacheHeader), levels.size() * sizeof(TextureCacheLevel));
+        for (const TextureCacheLevel &level: levels)
+            if (level.offset + level.size > file->length())
+                return false;
+
+        texture.internalFormat = header.internalFormat;
+        texture.levels.swap(levels);
+        texture.mapping = file;
+        texture.blocks.clear();
+        width = header.width;
+        height = header.height;
+        components = header.components;
+        return true;
+    }
+
+    static bool Store(const std::string &cachePath, uint64_t key, const CompressedTexture &texture, int components)
+    {
+        TextureCacheHeader header;
+        memcpy(header.magic, magic(), sizeof(header.magic));
+        header.version = TEXTURE_CACHE_VERSION;
+        header.internalFormat = texture.internalFormat;
+        header.key = key;
+        header.width = texture.levels[0].width;
+        header.height = texture.levels[0].height;
+        header.components = components;
+        header.levelCount = texture.levels.size();
+
+        // level offsets are rebased from the in-memory block buffer onto the file layout
+        size_t offset = align(sizeof(TextureCacheHeader) + texture.levels.size() * sizeof(TextureCacheLevel));
+        std::vector<TextureCacheLevel> levels = texture.levels;
+        for (TextureCacheLevel &level: levels)
+        {
+            level.offset = offset;
+            offset = align(offset + level.size);
+        }
+
+        std::string blob;
+        blob.reserve(offset);
+        blob.append((const char *)&header, sizeof(header));
+        appendAligned(blob, levels.data(), levels.size() * sizeof(TextureCacheLevel));
+        for (size_t i = 0; i < levels.size(); i++)
+            appendAligned(blob, texture.LevelData(i), levels[i].size);
+        return AssetCache::WriteFile(cachePath, blob);
+    }
+
+    // builds the mip chain of a decoded image and block-compresses every level
+    static CompressedTexture Encode(const unsigned char *pixels, int width, int height, int components)
+    {
+        CompressedTexture texture;
+        texture.internalFormat = TextureCompressor::FormatFor(components);
+        std::vector<MipLevel> mips = TextureCompressor::BuildMipChain(pixels, width, height, components);
+
+        size_t total = 0;
+        for (const MipLevel &mip: mips)
+        {
+            TextureCacheLevel level;
+            level.width = mip.width;
+            level.height = mip.height;
+            level.offset = total;
+            level.size = TextureCompressor::CompressedSize(texture.internalFormat, mip.width, mip.height);
+            total += level.size;
+            texture.levels.push_back(level);
+        }
+        texture.blocks.resize(total);
+        for (size_t i = 0; i < mips.size(); i++)
+            TextureCompressor::Compress(texture.internalFormat, mips[i].pixels.data(), mips[i].width, mips[i].height,
+                                        components, texture.blocks.data() + texture.levels[i].offset);
+        return texture;
+    }
+
+private:
+    static const char *magic()
+    {
+        return "LOGLTEX";
+    }
+
+    static size_t align(size_t offset)
+    {
+        return (offset + 15) & ~(size_t)15;
+    }
+};
+#endif
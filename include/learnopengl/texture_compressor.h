@@ -0,0 +1,269 @@
+#ifndef TEXTURE_COMPRESSOR_H
+#define TEXTURE_COMPRESSOR_H
+
+#include <glad/glad.h>
+
+#include <algorithm>
+#include <cstdlib>
+#include <cstring>
+#include <vector>
+
+// S3TC and BPTC come from extensions our GL 3.3 core loader doesn't declare, RGTC (BC4/BC5) is core.
+#ifndef GL_COMPRESSED_RGB_S3TC_DXT1_EXT
+#define GL_COMPRESSED_RGB_S3TC_DXT1_EXT 0x83F0
+#endif
+#ifndef GL_COMPRESSED_RGBA_S3TC_DXT5_EXT
+#define GL_COMPRESSED_RGBA_S3TC_DXT5_EXT 0x83F3
+#endif
+#ifndef GL_COMPRESSED_RGBA_BPTC_UNORM
+#define GL_COMPRESSED_RGBA_BPTC_UNORM 0x8E8C
+#endif
+
+// one uncompressed level of a mip chain, tightly packed with `components` bytes per pixel
+struct MipLevel {
+    int width;
+    int height;
+    std::vector<unsigned char> pixels;
+};
+
+// CPU encoder for the 4x4 block formats: BC1 (RGB), BC3 (RGBA), BC4 (R) and BC5 (RG).
+// Endpoints are picked from the block's inset bounding box, oriented along the dominant channel's correlation,
+// which is fast enough to run on first load and good enough for the color maps we ship.
+// BC7 is only understood by the upload path (for containers produced by external tools), we don't encode it.
+class TextureCompressor
+{
+public:
+    // block format used for an image with the given number of 8-bit channels
+    static GLenum FormatFor(int components)
+    {
+        if (components == 1)
+            return GL_COMPRESSED_RED_RGTC1;
+        else if (components == 2)
+            return GL_COMPRESSED_RG_RGTC2;
+        else if (components == 4)
+            return GL_COMPRESSED_RGBA_S3TC_DXT5_EXT;
+        return GL_COMPRESSED_RGB_S3TC_DXT1_EXT;
+    }
+
+    static size_t BlockBytes(GLenum format)
+    {
+        return (format == GL_COMPRESSED_RGB_S3TC_DXT1_EXT || format == GL_COMPRESSED_RED_RGTC1) ? 8 : 16;
+    }
+
+    static size_t CompressedSize(GLenum format, int width, int height)
+    {
+        return (size_t)((width + 3) / 4) * ((height + 3) / 4) * BlockBytes(format);
+    }
+
+    // full mip chain down to 1x1 with a 2x2 box filter, level 0 is a copy of the source
+    static std::vector<MipLevel> BuildMipChain(const unsigned char *pixels, int width, int height, int components)
+    {
+        std::vector<MipLevel> levels(1);
+        levels[0].width = width;
+        levels[0].height = height;
+        levels[0].pixels.assign(pixels, pixels + (size_t)width * height * components);
+        while (levels.back().width > 1 || levels.back().height > 1)
+        {
+            const MipLevel &source = levels.back();
+            MipLevel level;
+            level.width = std::max(1, source.width / 2);
+            level.height = std::max(1, source.height / 2);
+            level.pixels.resize((size_t)level.width * level.height * components);
+            for (int y = 0; y < level.height; y++)
+            {
+                int y0 = std::min(2 * y, source.height - 1), y1 = std::min(2 * y + 1, source.height - 1);
+                for (int x = 0; x < level.width; x++)
+                {
+                    int x0 = std::min(2 * x, source.width - 1), x1 = std::min(2 * x + 1, source.width - 1);
+                    for (int c = 0; c < components; c++)
+                    {
+                        int sum = source.pixels[((size_t)y0 * source.width + x0) * components + c] +
+                                  source.pixels[((size_t)y0 * source.width + x1) * components + c] +
+                                  source.pixels[((size_t)y1 * source.width + x0) * components + c] +
+                                  source.pixels[((size_t)y1 * source.width + x1) * components + c];
+                        level.pixels[((size_t)y * level.width + x) * components + c] = (unsigned char)((sum + 2) / 4);
+                    }
+                }
+            }
+            levels.push_back(std::move(level));
+        }
+        return levels;
+    }
+
+    // encodes one level into `out`, which must hold CompressedSize(format, width, height) bytes
+    static void Compress(GLenum format, const unsigned char *pixels, int width, int height, int components, unsigned char *out)
+    {
+        size_t blockBytes = BlockBytes(format);
+        for (int by = 0; by < height; by += 4)
+        {
+            for (int bx = 0; bx < width; bx += 4)
+            {
+                unsigned char block[16][4];
+                fetchBlock(pixels, width, height, components, bx, by, block);
+                if (format == GL_COMPRESSED_RGB_S3TC_DXT1_EXT)
+                {
+                    encodeColorBlock(block, out);
+                }
+                else if (format == GL_COMPRESSED_RGBA_S3TC_DXT5_EXT)
+                {
+                    encodeChannelBlock(block, 3, out);
+                    encodeColorBlock(block, out + 8);
+                }
+                else if (format == GL_COMPRESSED_RED_RGTC1)
+                {
+                    encodeChannelBlock(block, 0, out);
+                }
+                else if (format == GL_COMPRESSED_RG_RGTC2)
+                {
+                    encodeChannelBlock(block, 0, out);
+                    encodeChannelBlock(block, 1, out + 8);
+                }
+                out += blockBytes;
+            }
+        }
+    }
+
+private:
+    // reads a 4x4 block as RGBA, clamping at the image edges
+    static void fetchBlock(const unsigned char *pixels, int width, int height, int components, int bx, int by,
+                           unsigned char block[16][4])
+    {
+        for (int i = 0; i < 16; i++)
+        {
+            int x = std::min(bx + i % 4, width - 1);
+            int y = std::min(by + i / 4, height - 1);
+            const unsigned char *pixel = pixels + ((size_t)y * width + x) * components;
+            block[i][0] = pixel[0];
+            block[i][1] = components > 1 ? pixel[1] : 0;
+            block[i][2] = components > 2 ? pixel[2] : 0;
+            block[i][3] = components > 3 ? pixel[3] : 255;
+        }
+    }
+
+    static unsigned short pack565(const int color[3])
+    {
+        return (unsigned short)(((color[0] * 31 + 127) / 255) << 11 | ((color[1] * 63 + 127) / 255) << 5 | ((color[2] * 31 + 127) / 255));
+    }
+
+    static void unpack565(unsigned short packed, int color[3])
+    {
+        int r = (packed >> 11) & 31, g = (packed >> 5) & 63, b = packed & 31;
+        color[0] = (r << 3) | (r >> 2);
+        color[1] = (g << 2) | (g >> 4);
+        color[2] = (b << 3) | (b >> 2);
+    }
+
+    // BC1 color block: two 565 endpoints and 2-bit indices, always in 4-color mode (color0 > color1)
+    static void encodeColorBlock(const unsigned char block[16][4], unsigned char out[8])
+    {
+        int minColor[3] = {255, 255, 255}, maxColor[3] = {0, 0, 0};
+        float mean[3] = {0.0f, 0.0f, 0.0f};
+        for (int i = 0; i < 16; i++)
+            for (int c = 0; c < 3; c++)
+            {
+                minColor[c] = std::min(minColor[c], (int)block[i][c]);
+                maxColor[c] = std::max(maxColor[c], (int)block[i][c]);
+                mean[c] += block[i][c] / 16.0f;
+            }
+
+        // the bounding box diagonal has to follow the colors: flip channels that anti-correlate with the widest one
+        int axis = 0;
+        for (int c = 1; c < 3; c++)
+            if (maxColor[c] - minColor[c] > maxColor[axis] - minColor[axis])
+                axis = c;
+        for (int c = 0; c < 3; c++)
+        {
+            if (c == axis)
+                continue;
+            float covariance = 0.0f;
+            for (int i = 0; i < 16; i++)
+                covariance += (block[i][axis] - mean[axis]) * (block[i][c] - mean[c]);
+            if (covariance < 0.0f)
+                std::swap(minColor[c], maxColor[c]);
+        }
+        // inset the box a little so the endpoints aren't dominated by outliers
+        for (int c = 0; c < 3; c++)
+        {
+            int inset = (maxColor[c] - minColor[c]) / 16;
+            maxColor[c] -= inset;
+            minColor[c] += inset;
+        }
+
+        unsigned short color0 = pack565(maxColor), color1 = pack565(minColor);
+        if (color0 < color1)
+            std::swap(color0, color1);
+
+        unsigned int indices = 0;
+        if (color0 != color1)
+        {
+            int palette[4][3];
+            unpack565(color0, palette[0]);
+            unpack565(color1, palette[1]);
+            for (int c = 0; c < 3; c++)
+            {
+                palette[2][c] = (2 * palette[0][c] + palette[1][c]) / 3;
+                palette[3][c] = (palette[0][c] + 2 * palette[1][c]) / 3;
+            }
+            for (int i = 0; i < 16; i++)
+            {
+                int best = 0, bestDistance = 1 << 30;
+                for (int p = 0; p < 4; p++)
+                {
+                    int dr = block[i][0] - palette[p][0], dg = block[i][1] - palette[p][1], db = block[i][2] - palette[p][2];
+                    int distance = dr * dr + dg * dg + db * db;
+                    if (distance < bestDistance)
+                    {
+                        bestDistance = distance;
+                        best = p;
+                    }
+                }
+                indices |= (unsigned int)best << (2 * i);
+            }
+        }
+        out[0] = color0 & 0xFF;
+        out[1] = color0 >> 8;
+        out[2] = color1 & 0xFF;
+        out[3] = color1 >> 8;
+        memcpy(out + 4, &indices, 4);
+    }
+
+    // BC4 block (also the alpha half of BC3): two 8-bit endpoints and 3-bit indices, 8-value mode
+    static void encodeChannelBlock(const unsigned char block[16][4], int channel, unsigned char out[8])
+    {
+        int minValue = 255, maxValue = 0;
+        for (int i = 0; i < 16; i++)
+        {
+            minValue = std::min(minValue, (int)block[i][channel]);
+            maxValue = std::max(maxValue, (int)block[i][channel]);
+        }
+        out[0] = (unsigned char)maxValue;
+        out[1] = (unsigned char)minValue;
+
+        unsigned long long indices = 0;
+        if (maxValue != minValue)
+        {
+            int palette[8];
+            palette[0] = maxValue;
+            palette[1] = minValue;
+            for (int p = 1; p < 7; p++)
+                palette[p + 1] = ((7 - p) * maxValue + p * minValue) / 7;
+            for (int i = 0; i < 16; i++)
+            {
+                int best = 0, bestDistance = 256;
+                for (int p = 0; p < 8; p++)
+                {
+                    int distance = std::abs(block[i][channel] - palette[p]);
+                    if (distance < bestDistance)
+                    {
+                        bestDistance = distance;
+                        best = p;
+                    }
+                }
+                indices |= (unsigned long long)best << (3 * i);
+            }
+        }
+        for (int b = 0; b < 6; b++)
+            out[2 + b] = (unsigned char)(indices >> (8 * b));
+    }
+};
+#endif
@@ -0,0 +1,321 @@
+#ifndef TEXTURE_LOADER_H
+#define TEXTURE_LOADER_H
+
+#include <glad/glad.h>
+#include <stb_image.h>
+
+#include <learnopengl/pixel_upload_ring.h>
+#include <learnopengl/texture_cache.h>
+
+#include <algorithm>
+#include <cstring>
+#include <iostream>
+#include <string>
+#include <vector>
+
+// decoded pixels of one image, owned by stb_image until Free is called.
+// when block compression is enabled the image is carried as a compressed mip chain instead and data stays null;
+// with streaming enabled an uncompressed image is carried as its full mip chain in `mips` instead.
+struct TextureImage {
+    std::string path;
+    int width = 0;
+    int height = 0;
+    int components = 0;
+    unsigned char *data = nullptr;
+    CompressedTexture compressed;
+    std::vector<MipLevel> mips;
+};
+
+// Texture loading split into a decode half, which touches no GL state and can run on any thread,
+// and an upload half that has to run on the thread owning the GL context.
+// With compression enabled, Decode reads the baked block-compressed mip chain from the texture cache,
+// or on a miss decodes the source once, encodes it and writes the cache for the next start.
+class TextureLoader
+{
+public:
+    // checks which block formats the driver takes. call once on the GL thread, before any Decode;
+    // until then (or without S3TC support) textures are decoded and uploaded uncompressed.
+    static void EnableCompression()
+    {
+        GLint count = 0;
+        glGetIntegerv(GL_NUM_EXTENSIONS, &count);
+        for (GLint i = 0; i < count; i++)
+        {
+            const char *name = (const char *)glGetStringi(GL_EXTENSIONS, i);
+            if (strcmp(name, "GL_EXT_texture_compression_s3tc") == 0)
+                support().s3tc = true;
+            else if (strcmp(name, "GL_ARB_texture_compression_bptc") == 0)
+                support().bptc = true;
+        }
+        support().enabled = support().s3tc;
+    }
+
+    // turns on compression without a GL context, for offline baking: Decode encodes and writes the texture cache
+    // as if the driver supported S3TC, which is what the runtime needs to use the baked files
+    static void EnableOfflineCompression()
+    {
+        support().s3tc = true;
+        support().enabled = true;
+    }
+
+    // makes Decode build the mip chain of uncompressed images on the decoding thread, so TextureStreamer can
+    // upload them level by level
+    static void EnableMipChains()
+    {
+        support().mipChains = true;
+    }
+
+    static TextureImage Decode(const std::string &path)
+    {
+        TextureImage image;
+        image.path = path;
+        if (!support().enabled)
+        {
+            image.data = stbi_load(path.c_str(), &image.width, &image.height, &image.components, 0);
+            if (image.data && support().mipChains)
+            {
+                image.mips = TextureCompressor::BuildMipChain(image.data, image.width, image.height, image.components);
+                stbi_image_free(image.data);
+                image.data = nullptr;
+            }
+            return image;
+        }
+
+        std::string cachePath = TextureCache::PathFor(path);
+        uint64_t cacheKey = TextureCache::Key(path);
+        if (cacheKey != 0 && TextureCache::Load(cachePath, cacheKey, image.compressed, image.width, image.height, image.components))
+        {
+            if (formatSupported(image.compressed.internalFormat))
+                return image;
+            image.compressed = CompressedTexture();
+        }
+
+        image.data = stbi_load(path.c_str(), &image.width, &image.height, &image.components, 0);
+        if (image.data)
+        {
+            image.compressed = TextureCache::Encode(image.data, image.width, image.height, image.components);
+            stbi_image_free(image.data);
+            image.data = nullptr;
+            if (cacheKey != 0 && !TextureCache::Store(cachePath, cacheKey, image.compressed, image.components))
+                std::cout << "WARNING::TEXTURE_CACHE:: could not write " << cachePath << std::endl;
+        }
+        return image;
+    }
+
+    // decodes an image held in memory (e.g. embedded in a .glb). `name` only labels it; there is no file
+    // to key the texture cache on, so compressed images are encoded on every load.
+    static TextureImage DecodeMemory(const unsigned char *bytes, size_t size, const std::string &name)
+    {
+        TextureImage image;
+        image.path = name;
+        image.data = stbi_load_from_memory(bytes, (int)size, &image.width, &image.height, &image.components, 0);
+        if (!image.data)
+            return image;
+        if (support().enabled)
+            image.compressed = TextureCache::Encode(image.data, image.width, image.height, image.components);
+        else if (support().mipChains)
+            image.mips = TextureCompressor::BuildMipChain(image.data, image.width, image.height, image.components);
+        else
+            return image;
+        stbi_image_free(image.data);
+        image.data = nullptr;
+        return image;
+    }
+
+    static void Free(TextureImage &image)
+    {
+        stbi_image_free(image.data);
+        image.data = nullptr;
+        image.compressed = CompressedTexture();
+        image.mips.clear();
+    }
+
+    static GLenum Format(int components)
+    {
+        if (components == 1)
+            return GL_RED;
+        else if (components == 4)
+            return GL_RGBA;
+        return GL_RGB;
+    }
+
+    // uploads a decoded image as a repeating, mipmapped 2D texture
+    static unsigned int Upload2D(const TextureImage &image)
+    {
+        unsigned int textureID;
+        glGenTextures(1, &textureID);
+        if (!image.compressed.levels.empty() || !image.mips.empty() || image.data)
+        {
+            glBindTexture(GL_TEXTURE_2D, textureID);
+            if (!image.compressed.levels.empty())
+            {
+                // the baked chain already holds every mip level
+                const CompressedTexture &compressed = image.compressed;
+                for (size_t level = 0; level < compressed.levels.size(); level++)
+                    CompressedTexImage2D(GL_TEXTURE_2D, level, compressed.internalFormat, compressed.levels[level].width,
+                                         compressed.levels[level].height, compressed.LevelData(level), compressed.levels[level].size);
+                glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAX_LEVEL, compressed.levels.size() - 1);
+            }
+            else if (!image.mips.empty())
+            {
+                GLenum format = Format(image.components);
+                for (size_t level = 0; level < image.mips.size(); level++)
+                    TexImage2D(GL_TEXTURE_2D, level, format, image.mips[level].width, image.mips[level].height,
+                               image.mips[level].pixels.data(), image.mips[level].pixels.size());
+                glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAX_LEVEL, image.mips.size() - 1);
+            }
+            else
+            {
+                GLenum format = Format(image.components);
+                TexImage2D(GL_TEXTURE_2D, 0, format, image.width, image.height, image.data,
+                           (size_t)image.width * image.height * image.components);
+                glGenerateMipmap(GL_TEXTURE_2D);
+            }
+
+            glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_S, GL_REPEAT);
+            glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_T, GL_REPEAT);
+            glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, GL_LINEAR_MIPMAP_LINEAR);
+            glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAG_FILTER, GL_LINEAR);
+        }
+        else
+        {
+            std::cout << "Texture failed to load at path: " << image.path << std::endl;
+        }
+        return textureID;
+    }
+
+    // uploads six decoded faces (+X, -X, +Y, -Y, +Z, -Z) as a clamped cubemap
+    static unsigned int UploadCubemap(const std::vector<TextureImage> &faces)
+    {
+        unsigned int textureID;
+        glGenTextures(1, &textureID);
+        glBindTexture(GL_TEXTURE_CUBE_MAP, textureID);
+
+        for (unsigned int i = 0; i < faces.size(); i++)
+        {
+            if (!faces[i].compressed.levels.empty())
+            {
+                const CompressedTexture &compressed = faces[i].compressed;
+                CompressedTexImage2D(GL_TEXTURE_CUBE_MAP_POSITIVE_X + i, 0, compressed.internalFormat, compressed.levels[0].width,
+                                     compressed.levels[0].height, compressed.LevelData(0), compressed.levels[0].size);
+            }
+            else if (!faces[i].mips.empty())
+            {
+                // decoded for streaming; cubemaps aren't streamed and sample level 0 only
+                const MipLevel &base = faces[i].mips[0];
+                TexImage2D(GL_TEXTURE_CUBE_MAP_POSITIVE_X + i, 0, Format(faces[i].components), base.width, base.height,
+                           base.pixels.data(), base.pixels.size());
+            }
+            else if (faces[i].data)
+                TexImage2D(GL_TEXTURE_CUBE_MAP_POSITIVE_X + i, 0, Format(faces[i].components), faces[i].width, faces[i].height,
+                           faces[i].data, (size_t)faces[i].width * faces[i].height * faces[i].components);
+            else
+                std::cout << "Cubemap texture failed to load at path: " << faces[i].path << std::endl;
+        }
+        glTexParameteri(GL_TEXTURE_CUBE_MAP, GL_TEXTURE_MIN_FILTER, GL_LINEAR);
+        glTexParameteri(GL_TEXTURE_CUBE_MAP, GL_TEXTURE_MAG_FILTER, GL_LINEAR);
+        glTexParameteri(GL_TEXTURE_CUBE_MAP, GL_TEXTURE_WRAP_S, GL_CLAMP_TO_EDGE);
+        glTexParameteri(GL_TEXTURE_CUBE_MAP, GL_TEXTURE_WRAP_T, GL_CLAMP_TO_EDGE);
+        glTexParameteri(GL_TEXTURE_CUBE_MAP, GL_TEXTURE_WRAP_R, GL_CLAMP_TO_EDGE);
+        return textureID;
+    }
+
+    // glTexImage2D of tightly packed 8-bit pixels, staged through the PixelUploadRing. a level larger than
+    // the ring stages at once is allocated empty and filled with sub-image uploads, a band of rows at a time.
+    static void TexImage2D(GLenum target, GLint level, GLenum format, int width, int height, const unsigned char *pixels, size_t size)
+    {
+        PixelUploadRing &ring = PixelUploadRing::Get();
+        glPixelStorei(GL_UNPACK_ALIGNMENT, 1);
+        if (size <= ring.MaxStageBytes())
+        {
+            const void *source = ring.Stage(pixels, size);
+            glTexImage2D(target, level, format, width, height, 0, format, GL_UNSIGNED_BYTE, source);
+            ring.Submit();
+        }
+        else
+        {
+            glTexImage2D(target, level, format, width, height, 0, format, GL_UNSIGNED_BYTE, nullptr);
+            // bands of a quarter of the ring, so the next one is copied while the GPU still reads the last
+            size_t rowBytes = size / height;
+            int band = std::max<size_t>(1, ring.MaxStageBytes() / 2 / rowBytes);
+            for (int y = 0; y < height; y += band)
+            {
+                int rows = std::min(band, height - y);
+                const void *source = ring.Stage(pixels + y * rowBytes, rows * rowBytes);
+                glTexSubImage2D(target, level, 0, y, width, rows, format, GL_UNSIGNED_BYTE, source);
+                ring.Submit();
+            }
+        }
+        glPixelStorei(GL_UNPACK_ALIGNMENT, 4);
+    }
+
+    // the same for a compressed level, whose bands are rows of 4x4 blocks
+    static void CompressedTexImage2D(GLenum target, GLint level, GLenum internalFormat, int width, int height,
+                                     const unsigned char *blocks, size_t size)
+    {
+        PixelUploadRing &ring = PixelUploadRing::Get();
+        if (size <= ring.MaxStageBytes())
+        {
+            const void *source = ring.Stage(blocks, size);
+            glCompressedTexImage2D(target, level, internalFormat, width, height, 0, size, source);
+            ring.Submit();
+            return;
+        }
+        glTexImage2D(target, level, internalFormat, width, height, 0, GL_RGBA, GL_UNSIGNED_BYTE, nullptr);
+        int blockRows = (height + 3) / 4;
+        size_t rowBytes = size / blockRows;
+        int band = std::max<size_t>(1, ring.MaxStageBytes() / 2 / rowBytes);
+        for (int row = 0; row < blockRows; row += band)
+        {
+            int rows = std::min(band, blockRows - row);
+            int y = row * 4;
+            const void *source = ring.Stage(blocks + row * rowBytes, rows * rowBytes);
+            glCompressedTexSubImage2D(target, level, 0, y, width, std::min(rows * 4, height - y), internalFormat,
+                                      rows * rowBytes, source);
+            ring.Submit();
+        }
+    }
+
+    static unsigned int Load2D(const std::string &path)
+    {
+        TextureImage image = Decode(path);
+        unsigned int textureID = Upload2D(image);
+        Free(image);
+        return textureID;
+    }
+
+    static unsigned int LoadCubemap(const std::vector<std::string> &paths)
+    {
+        std::vector<TextureImage> faces;
+        for (const std::string &path: paths)
+            faces.push_back(Decode(path));
+        unsigned int textureID = UploadCubemap(faces);
+        for (TextureImage &face: faces)
+            Free(face);
+        return textureID;
+    }
+
+private:
+    struct CompressionSupport {
+        bool enabled = false;
+        bool mipChains = false;
+        bool s3tc = false;
+        bool bptc = false;
+    };
+
+    static CompressionSupport &support()
+    {
+        static CompressionSupport compressionSupport;
+        return compressionSupport;
+    }
+
+    static bool formatSupported(GLenum format)
+    {
+        if (format == GL_COMPRESSED_RGBA_BPTC_UNORM)
+            return support().bptc;
+        if (format == GL_COMPRESSED_RGB_S3TC_DXT1_EXT || format == GL_COMPRESSED_RGBA_S3TC_DXT5_EXT)
+            return support().s3tc;
+        return format == GL_COMPRESSED_RED_RGTC1 || format == GL_COMPRESSED_RG_RGTC2;
+    }
+};
+#endif
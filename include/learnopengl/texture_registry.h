@@ -0,0 +1,189 @@
+#ifndef TEXTURE_REGISTRY_H
+#define TEXTURE_REGISTRY_H
+
+#include <glad/glad.h>
+
+#include <learnopengl/asset_cache.h>
+#include <learnopengl/gl_state.h>
+#include <learnopengl/texture_loader.h>
+#include <learnopengl/texture_streamer.h>
+
+#include <climits>
+#include <cstdlib>
+#include <mutex>
+#include <string>
+#include <unordered_map>
+#include <vector>
+
+struct TextureRegistryStats {
+    size_t textures = 0;   // resident GL textures
+    size_t references = 0; // outstanding Acquire/Insert references
+    size_t hits = 0;       // lookups served by an already resident texture
+    size_t misses = 0;
+};
+
+// Process-wide table of the GL textures loaded so far, keyed by image content, so an image referenced from
+// several models or scene objects (or under several paths) is decoded and uploaded once.
+// A path is canonicalized and hashed the first time it's seen; later lookups of the same path are a map hit.
+// Textures are reference counted and deleted when the last reference is released.
+// Key and Contains may be called from any thread, everything touching GL only from the GL thread.
+class TextureRegistry
+{
+public:
+    // content key of an image file, 0 if it can't be read
+    static uint64_t Key(const std::string &path)
+    {
+        std::string canonical = canonicalPath(path);
+        {
+            std::lock_guard<std::mutex> lock(state().mutex);
+            auto known = state().pathKeys.find(canonical);
+            if (known != state().pathKeys.end())
+                return known->second;
+        }
+        uint64_t key = AssetCache::HashFile(canonical);
+        std::lock_guard<std::mutex> lock(state().mutex);
+        state().pathKeys[canonical] = key;
+        return key;
+    }
+
+    // key of a cubemap: its faces' contents, in order
+    static uint64_t CubemapKey(const std::vector<std::string> &paths)
+    {
+        uint64_t key = fnv1a("cubemap");
+        for (const std::string &path: paths)
+        {
+            uint64_t face = Key(path);
+            if (face == 0)
+                return 0;
+            key = fnv1aValue(face, key);
+        }
+        return key;
+    }
+
+    static bool Contains(uint64_t key)
+    {
+        std::lock_guard<std::mutex> lock(state().mutex);
+        return key != 0 && state().textures.find(key) != state().textures.end();
+    }
+
+    // id of the resident texture with this key plus a reference on it, 0 if there is none
+    static unsigned int Acquire(uint64_t key)
+    {
+        std::lock_guard<std::mutex> lock(state().mutex);
+        auto entry = key != 0 ? state().textures.find(key) : state().textures.end();
+        if (entry == state().textures.end())
+        {
+            state().stats.misses++;
+            return 0;
+        }
+        entry->second.references++;
+        state().stats.hits++;
+        state().stats.references++;
+        return entry->second.id;
+    }
+
+    // registers a texture that was just uploaded for `key`, with one reference for the caller.
+    // if the key got registered in the meantime the new texture is deleted and the resident one returned.
+    static unsigned int Insert(uint64_t key, unsigned int id)
+    {
+        if (key == 0)
+            return id;
+        std::lock_guard<std::mutex> lock(state().mutex);
+        auto entry = state().textures.find(key);
+        if (entry != state().textures.end())
+        {
+            glDeleteTextures(1, &id);
+            GLState::TextureDeleted(id);
+            entry->second.references++;
+            state().stats.references++;
+            return entry->second.id;
+        }
+        state().textures[key] = Entry{id, 1};
+        state().keys[id] = key;
+        state().stats.references++;
+        return id;
+    }
+
+    // drops a reference, deleting the texture with the last one. ids the registry doesn't know are deleted directly.
+    static void Release(unsigned int id)
+    {
+        if (id == 0)
+            return;
+        std::lock_guard<std::mutex> lock(state().mutex);
+        auto key = state().keys.find(id);
+        if (key == state().keys.end())
+        {
+            TextureStreamer::Cancel(id);
+            glDeleteTextures(1, &id);
+            GLState::TextureDeleted(id);
+            return;
+        }
+        auto entry = state().textures.find(key->second);
+        state().stats.references--;
+        if (--entry->second.references == 0)
+        {
+            TextureStreamer::Cancel(id);
+            glDeleteTextures(1, &id);
+            GLState::TextureDeleted(id);
+            state().textures.erase(entry);
+            state().keys.erase(key);
+        }
+    }
+
+    // loads a 2D texture unless an identical image is resident already. streamed when TextureStreamer is enabled.
+    static unsigned int Load2D(const std::string &path)
+    {
+        uint64_t key = Key(path);
+        unsigned int id = Acquire(key);
+        if (id == 0)
+            id = Insert(key, TextureStreamer::Upload2D(TextureLoader::Decode(path)));
+        return id;
+    }
+
+    static unsigned int LoadCubemap(const std::vector<std::string> &paths)
+    {
+        uint64_t key = CubemapKey(paths);
+        unsigned int id = Acquire(key);
+        if (id == 0)
+            id = Insert(key, TextureLoader::LoadCubemap(paths));
+        return id;
+    }
+
+    static TextureRegistryStats Stats()
+    {
+        std::lock_guard<std::mutex> lock(state().mutex);
+        TextureRegistryStats stats = state().stats;
+        stats.textures = state().textures.size();
+        return stats;
+    }
+
+private:
+    struct Entry {
+        unsigned int id;
+        unsigned int references;
+    };
+
+    struct State {
+        std::mutex mutex;
+        std::unordered_map<std::string, uint64_t> pathKeys;
+        std::unordered_map<uint64_t, Entry> textures;
+        std::unordered_map<unsigned int, uint64_t> keys;
+        TextureRegistryStats stats;
+    };
+
+    static State &state()
+    {
+        static State registryState;
+        return registryState;
+    }
+
+    // resolves "..", "." and symlinks so different spellings of a path share one entry
+    static std::string canonicalPath(const std::string &path)
+    {
+        char resolved[PATH_MAX];
+        if (realpath(path.c_str(), resolved))
+            return resolved;
+        return path;
+    }
+};
+#endif
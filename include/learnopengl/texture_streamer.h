@@ -0,0 +1,255 @@
+#ifndef TEXTURE_STREAMER_H
+#define TEXTURE_STREAMER_H
+
+#include <glad/glad.h>
+
+#include <learnopengl/texture_loader.h>
+
+#include <algorithm>
+#include <chrono>
+#include <deque>
+#include <iostream>
+#include <sstream>
+#include <string>
+
+struct TextureStreamingStats {
+    size_t pending = 0;             // textures not at full resolution yet
+    size_t bytesPending = 0;        // level data still to upload
+    size_t bytesLastFrame = 0;      // uploaded by the last Update
+    float msLastFrame = 0.0f;       // time the last Update spent uploading
+    size_t completed = 0;
+    float lastTimeToFullMs = 0.0f;  // from the first visible level to full resolution, of the last finished texture
+    float maxTimeToFullMs = 0.0f;
+};
+
+// Mip-first texture uploads. A streamed texture gets storage for its whole chain, but only the small tail
+// levels are uploaded right away and GL_TEXTURE_BASE_LEVEL is clamped to the finest level present, so the
+// texture can be sampled immediately at low resolution. Update uploads the remaining levels, finest last and
+// in bands of rows, until the frame's time budget is used up, lowering the base level as each one completes.
+// Images have to carry a mip chain: compressed (texture cache) or uncompressed via TextureLoader::EnableMipChains.
+// GL thread only.
+class TextureStreamer
+{
+public:
+    // turns streaming on for Upload2D, with the per-frame upload budget in milliseconds
+    static void Enable(float budgetMs = 2.0f)
+    {
+        state().enabled = true;
+        state().budgetMs = budgetMs;
+        TextureLoader::EnableMipChains();
+    }
+
+    static bool Enabled()
+    {
+        return state().enabled;
+    }
+
+    // uploads the image as a repeating, mipmapped 2D texture and frees it. with streaming enabled only the
+    // levels up to `immediateSize` texels are uploaded now and the rest is queued for Update.
+    static unsigned int Upload2D(TextureImage &&image, int immediateSize = 64)
+    {
+        int levelCount = (int)std::max(image.compressed.levels.size(), image.mips.size());
+        if (!state().enabled || levelCount < 2)
+        {
+            unsigned int textureID = TextureLoader::Upload2D(image);
+            TextureLoader::Free(image);
+            return textureID;
+        }
+
+        Job job;
+        job.image = std::move(image);
+        image.data = nullptr;
+        job.compressed = !job.image.compressed.levels.empty();
+        job.levelCount = levelCount;
+        glGenTextures(1, &job.id);
+        glBindTexture(GL_TEXTURE_2D, job.id);
+        // storage for every level up front, so levels can be filled in any order with sub-image uploads
+        GLenum format = TextureLoader::Format(job.image.components);
+        GLenum internalFormat = job.compressed ? job.image.compressed.internalFormat : format;
+        for (int level = 0; level < levelCount; level++)
+            glTexImage2D(GL_TEXTURE_2D, level, internalFormat, levelWidth(job, level), levelHeight(job, level), 0, format,
+                         GL_UNSIGNED_BYTE, nullptr);
+        glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAX_LEVEL, levelCount - 1);
+        glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_S, GL_REPEAT);
+        glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_T, GL_REPEAT);
+        glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, GL_LINEAR_MIPMAP_LINEAR);
+        glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAG_FILTER, GL_LINEAR);
+
+        // the tail goes up now; the first level that is larger than `immediateSize` is where streaming starts
+        job.level = levelCount - 1;
+        while (job.level >= 0 && std::max(levelWidth(job, job.level), levelHeight(job, job.level)) <= immediateSize)
+        {
+            uploadRows(job, job.level, 0, rowCount(job, job.level));
+            job.level--;
+        }
+        if (job.level == levelCount - 1)
+        {
+            // even the smallest level is larger than asked for, it's shown as soon as it's there
+            uploadRows(job, job.level, 0, rowCount(job, job.level));
+            job.level--;
+        }
+        glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_BASE_LEVEL, job.level + 1);
+
+        unsigned int textureID = job.id;
+        if (job.level < 0)
+            TextureLoader::Free(job.image);
+        else
+        {
+            job.start = std::chrono::steady_clock::now();
+            state().jobs.push_back(std::move(job));
+        }
+        return textureID;
+    }
+
+    // uploads queued levels until the frame budget is spent. call once per frame on the GL thread.
+    static void Update()
+    {
+        State &streaming = state();
+        auto frameStart = std::chrono::steady_clock::now();
+        streaming.stats.bytesLastFrame = 0;
+        while (!streaming.jobs.empty() && elapsedMs(frameStart) < streaming.budgetMs)
+        {
+            Job &job = streaming.jobs.front();
+            glBindTexture(GL_TEXTURE_2D, job.id);
+            // bands of about 256 KB, so one big level doesn't blow the budget on its own
+            size_t rows = rowCount(job, job.level);
+            size_t band = std::max<size_t>(1, (256 << 10) / std::max<size_t>(1, rowBytes(job, job.level)));
+            size_t count = std::min(band, rows - job.row);
+            streaming.stats.bytesLastFrame += uploadRows(job, job.level, job.row, count);
+            job.row += count;
+            if (job.row < rows)
+                continue;
+
+            glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_BASE_LEVEL, job.level);
+            job.level--;
+            job.row = 0;
+            if (job.level < 0)
+                finish(job);
+        }
+        streaming.stats.msLastFrame = elapsedMs(frameStart);
+    }
+
+    // stops streaming into a texture that is about to be deleted
+    static void Cancel(unsigned int textureID)
+    {
+        std::deque<Job> &jobs = state().jobs;
+        for (auto job = jobs.begin(); job != jobs.end(); ++job)
+        {
+            if (job->id == textureID)
+            {
+                TextureLoader::Free(job->image);
+                jobs.erase(job);
+                return;
+            }
+        }
+    }
+
+    static TextureStreamingStats Stats()
+    {
+        TextureStreamingStats stats = state().stats;
+        stats.pending = state().jobs.size();
+        stats.bytesPending = 0;
+        for (const Job &job: state().jobs)
+        {
+            stats.bytesPending += (rowCount(job, job.level) - job.row) * rowBytes(job, job.level);
+            for (int level = 0; level < job.level; level++)
+                stats.bytesPending += rowCount(job, level) * rowBytes(job, level);
+        }
+        return stats;
+    }
+
+private:
+    struct Job {
+        unsigned int id = 0;
+        TextureImage image;
+        bool compressed = false;
+        int levelCount = 0;
+        int level = 0;   // level being uploaded, everything above it is resident
+        size_t row = 0;  // next row (block row when compressed) of that level
+        std::chrono::steady_clock::time_point start;
+    };
+
+    struct State {
+        bool enabled = false;
+        float budgetMs = 2.0f;
+        std::deque<Job> jobs;
+        TextureStreamingStats stats;
+    };
+
+    static State &state()
+    {
+        static State streamingState;
+        return streamingState;
+    }
+
+    static float elapsedMs(std::chrono::steady_clock::time_point since)
+    {
+        return std::chrono::duration<float, std::milli>(std::chrono::steady_clock::now() - since).count();
+    }
+
+    static int levelWidth(const Job &job, int level)
+    {
+        return job.compressed ? job.image.compressed.levels[level].width : job.image.mips[level].width;
+    }
+
+    static int levelHeight(const Job &job, int level)
+    {
+        return job.compressed ? job.image.compressed.levels[level].height : job.image.mips[level].height;
+    }
+
+    // compressed levels are uploaded in rows of 4x4 blocks
+    static size_t rowCount(const Job &job, int level)
+    {
+        int height = levelHeight(job, level);
+        return job.compressed ? (height + 3) / 4 : height;
+    }
+
+    static size_t rowBytes(const Job &job, int level)
+    {
+        int width = levelWidth(job, level);
+        if (job.compressed)
+            return (width + 3) / 4 * TextureCompressor::BlockBytes(job.image.compressed.internalFormat);
+        return (size_t)width * job.image.components;
+    }
+
+    // rows are staged through the PixelUploadRing, so a band costs a memcpy on this thread instead of a driver copy
+    static size_t uploadRows(const Job &job, int level, size_t firstRow, size_t count)
+    {
+        int width = levelWidth(job, level);
+        size_t bytes = count * rowBytes(job, level);
+        PixelUploadRing &ring = PixelUploadRing::Get();
+        if (job.compressed)
+        {
+            const CompressedTexture &compressed = job.image.compressed;
+            int y = firstRow * 4;
+            int height = std::min<int>(count * 4, levelHeight(job, level) - y);
+            const void *source = ring.Stage(compressed.LevelData(level) + firstRow * rowBytes(job, level), bytes);
+            glCompressedTexSubImage2D(GL_TEXTURE_2D, level, 0, y, width, height, compressed.internalFormat, bytes, source);
+        }
+        else
+        {
+            const void *source = ring.Stage(job.image.mips[level].pixels.data() + firstRow * rowBytes(job, level), bytes);
+            glPixelStorei(GL_UNPACK_ALIGNMENT, 1);
+            glTexSubImage2D(GL_TEXTURE_2D, level, 0, firstRow, width, count, TextureLoader::Format(job.image.components),
+                            GL_UNSIGNED_BYTE, source);
+            glPixelStorei(GL_UNPACK_ALIGNMENT, 4);
+        }
+        ring.Submit();
+        return bytes;
+    }
+
+    static void finish(Job &job)
+    {
+        TextureStreamingStats &stats = state().stats;
+        float ms = elapsedMs(job.start);
+        stats.completed++;
+        stats.lastTimeToFullMs = ms;
+        stats.maxTimeToFullMs = std::max(stats.maxTimeToFullMs, ms);
+        std::ostringstream log;
+        log << "TextureStreamer " << job.image.path << ": full resolution after " << ms << " ms\n";
+        std::cout << log.str();
+        TextureLoader::Free(job.image);
+        state().jobs.pop_front();
+    }
+};
+#endif
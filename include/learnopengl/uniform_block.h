@@ -0,0 +1,116 @@
+#ifndef UNIFORM_BLOCK_H
+#define UNIFORM_BLOCK_H
+
+#include <glad/glad.h>
+#include <glm/glm.hpp>
+
+#include <algorithm>
+#include <cstddef>
+#include <cstring>
+#include <vector>
+
+// std140 base alignment of the GLSL type a block member is stored as. only types whose C++ size matches their
+// std140 size are listed; vec3 is 12 bytes in both, but the next member can't start inside its 16-byte slot
+// unless it is a scalar (pad a lone vec3 with a float).
+template <typename T> struct Std140Alignment;
+template <> struct Std140Alignment<int>       { static constexpr size_t value = 4; };
+template <> struct Std140Alignment<float>     { static constexpr size_t value = 4; };
+template <> struct Std140Alignment<glm::vec2> { static constexpr size_t value = 8; };
+template <> struct Std140Alignment<glm::vec3> { static constexpr size_t value = 16; };
+template <> struct Std140Alignment<glm::vec4> { static constexpr size_t value = 16; };
+template <> struct Std140Alignment<glm::mat4> { static constexpr size_t value = 16; };
+// arrays align to 16 and so does their stride, which only matches C++ for elements padded to a multiple of 16
+template <typename T, size_t N> struct Std140Alignment<T[N]>
+{
+    static_assert(sizeof(T) % 16 == 0, "std140 array elements need padding to a multiple of 16 bytes");
+    static constexpr size_t value = 16;
+};
+
+// A C++ struct lays out like its std140 GLSL block when every member sits at a multiple of its std140
+// alignment: C++ never places a member later than std140 would, so no member can be off. checked per member,
+// the members of nested structs included, with STD140_MEMBER.
+#define STD140_MEMBER(Block, member) \
+    static_assert(offsetof(Block, member) % Std140Alignment<decltype(Block::member)>::value == 0, \
+                  #Block "::" #member " is not std140 aligned")
+
+// A uniform block shared by every program that declares it, as `layout (std140) uniform <T::Name>`. T is the
+// block's C++ mirror, with `static constexpr const char *Name` and `static constexpr GLuint Binding` (the
+// binding point, one per block type). Update writes a new copy once per frame into the next slot of a ring of
+// `frames` copies and binds that slot, so the upload never waits for the GPU to finish drawing with an older
+// one; a slot is only rewritten after the fence behind its last use passed.
+// Release the GL objects before the context goes away, the destructor doesn't.
+template <typename T>
+class UniformBlock
+{
+public:
+    explicit UniformBlock(unsigned int frames = 3) : fences(frames, nullptr)
+    {
+        GLint alignment = 256;
+        glGetIntegerv(GL_UNIFORM_BUFFER_OFFSET_ALIGNMENT, &alignment);
+        stride = (sizeof(T) + alignment - 1) / alignment * alignment;
+        glGenBuffers(1, &buffer);
+        glBindBuffer(GL_UNIFORM_BUFFER, buffer);
+        glBufferData(GL_UNIFORM_BUFFER, stride * frames, nullptr, GL_STREAM_DRAW);
+        glBindBuffer(GL_UNIFORM_BUFFER, 0);
+    }
+
+    UniformBlock(const UniformBlock &) = delete;
+    UniformBlock &operator=(const UniformBlock &) = delete;
+
+    // connects the program's block of this name, if it has one, to the block's binding point. binding points
+    // aren't kept in program binaries, so this goes after every link or load.
+    static void Attach(GLuint program)
+    {
+        GLuint index = glGetUniformBlockIndex(program, T::Name);
+        if (index != GL_INVALID_INDEX)
+            glUniformBlockBinding(program, index, T::Binding);
+    }
+
+    void Update(const T &data)
+    {
+        // whatever was drawn so far read the current slot
+        if (updated)
+            fences[current] = glFenceSync(GL_SYNC_GPU_COMMANDS_COMPLETE, 0);
+        current = (current + 1) % fences.size();
+        updated = true;
+        if (GLsync fence = fences[current])
+        {
+            while (glClientWaitSync(fence, GL_SYNC_FLUSH_COMMANDS_BIT, 1000000) == GL_TIMEOUT_EXPIRED)
+                ;
+            glDeleteSync(fence);
+            fences[current] = nullptr;
+        }
+
+        glBindBuffer(GL_UNIFORM_BUFFER, buffer);
+        if (void *mapped = glMapBufferRange(GL_UNIFORM_BUFFER, current * stride, sizeof(T),
+                                            GL_MAP_WRITE_BIT | GL_MAP_UNSYNCHRONIZED_BIT | GL_MAP_INVALIDATE_RANGE_BIT))
+        {
+            memcpy(mapped, &data, sizeof(T));
+            glUnmapBuffer(GL_UNIFORM_BUFFER);
+        }
+        else
+            glBufferSubData(GL_UNIFORM_BUFFER, current * stride, sizeof(T), &data);
+        glBindBuffer(GL_UNIFORM_BUFFER, 0);
+        glBindBufferRange(GL_UNIFORM_BUFFER, T::Binding, buffer, current * stride, sizeof(T));
+    }
+
+    void Release()
+    {
+        for (GLsync &fence: fences)
+            if (fence)
+                glDeleteSync(fence);
+        std::fill(fences.begin(), fences.end(), nullptr);
+        updated = false;
+        if (buffer)
+            glDeleteBuffers(1, &buffer);
+        buffer = 0;
+    }
+
+private:
+    GLuint buffer = 0;
+    size_t stride;
+    std::vector<GLsync> fences; // per slot, behind the draws that last read it
+    size_t current = 0;         // slot of the last Update
+    bool updated = false;
+};
+#endif
@@ -0,0 +1,272 @@
+#ifndef VERTEX_FORMAT_H
+#define VERTEX_FORMAT_H
+
+#include <glad/glad.h>
+
+#include <glm/glm.hpp>
+
+#include <algorithm>
+#include <cmath>
+#include <cstddef>
+#include <cstdint>
+#include <cstring>
+#include <vector>
+#ifdef __SSE2__
+#include <emmintrin.h>
+#endif
+
+struct Vertex {
+    // position
+    glm::vec3 Position;
+    // normal
+    glm::vec3 Normal;
+    // texCoords
+    glm::vec2 TexCoords;
+    // tangent
+    glm::vec3 Tangent;
+    // bitangent
+    glm::vec3 Bitangent;
+};
+
+// one array per vertex attribute, as importers hand them out. positions, normals, tangents and bitangents hold
+// 3 floats per vertex, texCoords `texCoordStride` floats of which the first two are used. missing streams are null.
+struct VertexStreams {
+    const float *positions = nullptr;
+    const float *normals = nullptr;
+    const float *texCoords = nullptr;
+    size_t texCoordStride = 2;
+    const float *tangents = nullptr;
+    const float *bitangents = nullptr;
+};
+
+class VertexInterleaver
+{
+public:
+    // writes `count` vertices from the streams, missing attributes are zero. with SSE2 each vertex is five
+    // unaligned 4-float loads and stores instead of 14 scalar copies: every store spills one float into the next
+    // field (or vertex), which the following store overwrites. the last vertex, whose loads and stores would run
+    // past the arrays, takes the scalar path.
+    static void Interleave(const VertexStreams &streams, size_t count, Vertex *out)
+    {
+        static_assert(sizeof(Vertex) == 14 * sizeof(float), "Vertex is expected to be 14 tightly packed floats");
+        size_t i = 0;
+#ifdef __SSE2__
+        const __m128 zero = _mm_setzero_ps();
+        for (; i + 1 < count; i++)
+        {
+            float *v = (float *)&out[i];
+            _mm_storeu_ps(v, load3(streams.positions, i, zero));
+            _mm_storeu_ps(v + 3, load3(streams.normals, i, zero));
+            _mm_storel_pi((__m64 *)(v + 6), streams.texCoords ? _mm_loadl_pi(zero, (const __m64 *)(streams.texCoords + i * streams.texCoordStride)) : zero);
+            _mm_storeu_ps(v + 8, load3(streams.tangents, i, zero));
+            _mm_storeu_ps(v + 11, load3(streams.bitangents, i, zero));
+        }
+#endif
+        for (; i < count; i++)
+        {
+            float *v = (float *)&out[i];
+            copy3(streams.positions, i, v);
+            copy3(streams.normals, i, v + 3);
+            v[6] = streams.texCoords ? streams.texCoords[i * streams.texCoordStride] : 0.0f;
+            v[7] = streams.texCoords ? streams.texCoords[i * streams.texCoordStride + 1] : 0.0f;
+            copy3(streams.tangents, i, v + 8);
+            copy3(streams.bitangents, i, v + 11);
+        }
+    }
+
+    // appends `count` vertices from the streams. goes through a small block that stays in cache rather than
+    // resizing first, which would write the whole destination twice.
+    static void Append(const VertexStreams &streams, size_t count, std::vector<Vertex> &out)
+    {
+        const size_t BLOCK = 256;
+        Vertex block[BLOCK];
+        out.reserve(out.size() + count);
+        for (size_t first = 0; first < count; first += BLOCK)
+        {
+            size_t size = std::min(BLOCK, count - first);
+            Interleave(offset(streams, first), size, block);
+            out.insert(out.end(), block, block + size);
+        }
+    }
+
+private:
+    static VertexStreams offset(VertexStreams streams, size_t first)
+    {
+        streams.positions += streams.positions ? 3 * first : 0;
+        streams.normals += streams.normals ? 3 * first : 0;
+        streams.texCoords += streams.texCoords ? streams.texCoordStride * first : 0;
+        streams.tangents += streams.tangents ? 3 * first : 0;
+        streams.bitangents += streams.bitangents ? 3 * first : 0;
+        return streams;
+    }
+
+#ifdef __SSE2__
+    // the fourth lane is the next vertex's first float, which callers never leave in place
+    static __m128 load3(const float *stream, size_t i, __m128 zero)
+    {
+        return stream ? _mm_loadu_ps(stream + 3 * i) : zero;
+    }
+#endif
+
+    static void copy3(const float *stream, size_t i, float *destination)
+    {
+        for (int k = 0; k < 3; k++)
+            destination[k] = stream ? stream[3 * i + k] : 0.0f;
+    }
+};
+
+// GPU-side vertex layouts a mesh can be uploaded in. Attribute locations stay the same for all of them
+// (0 position, 1 normal, 2 texCoords, 3 tangent, 4 bitangent), so the shaders don't care which one is used.
+//  - Full:            the Vertex struct as is, 14 floats (56 bytes)
+//  - Packed:          float position, 10-10-10-2 normal, 10-10-10-2 tangent with the bitangent sign in w,
+//                     half-float texCoords (24 bytes)
+//  - PackedQuantized: Packed with 16-bit normalized positions relative to the mesh bounds (20 bytes);
+//                     the shader applies positionScale/positionOffset, which Mesh::Draw sets per mesh
+// The scene geometry built in main.cpp (cubes, planes, skybox, screen quad) uses two simpler layouts,
+// with texCoords at location 1 as its shaders expect:
+//  - PositionTexCoords: 3 float position, 2 float texCoords (20 bytes)
+//  - Position:          3 float position (12 bytes)
+enum class VertexFormat {
+    Full,
+    Packed,
+    PackedQuantized,
+    PositionTexCoords,
+    Position,
+    Count
+};
+
+struct PackedVertex {
+    float    Position[3];
+    uint32_t Normal;
+    uint32_t Tangent;
+    uint16_t TexCoords[2];
+};
+
+struct QuantizedVertex {
+    uint16_t Position[4]; // w is padding to keep the normal 4-byte aligned
+    uint32_t Normal;
+    uint32_t Tangent;
+    uint16_t TexCoords[2];
+};
+
+static_assert(sizeof(PackedVertex) == 24, "PackedVertex is expected to be 24 bytes");
+static_assert(sizeof(QuantizedVertex) == 20, "QuantizedVertex is expected to be 20 bytes");
+
+// per-mesh transform back from quantized to object-space positions
+struct PositionDequantization {
+    glm::vec3 scale = glm::vec3(1.0f);
+    glm::vec3 offset = glm::vec3(0.0f);
+};
+
+class VertexLayout
+{
+public:
+    static GLsizei Stride(VertexFormat format)
+    {
+        switch (format)
+        {
+        case VertexFormat::Packed:            return sizeof(PackedVertex);
+        case VertexFormat::PackedQuantized:   return sizeof(QuantizedVertex);
+        case VertexFormat::PositionTexCoords: return 5 * sizeof(float);
+        case VertexFormat::Position:          return 3 * sizeof(float);
+        default:                              return sizeof(Vertex);
+        }
+    }
+
+    // attribute pointers for the vertex buffer currently bound to GL_ARRAY_BUFFER, in the given layout
+    static void Setup(VertexFormat format)
+    {
+        GLsizei stride = Stride(format);
+        if (format == VertexFormat::Full)
+        {
+            // vertex Positions
+            glEnableVertexAttribArray(0);
+            glVertexAttribPointer(0, 3, GL_FLOAT, GL_FALSE, stride, (void*)0);
+            // vertex normals
+            glEnableVertexAttribArray(1);
+            glVertexAttribPointer(1, 3, GL_FLOAT, GL_FALSE, stride, (void*)offsetof(Vertex, Normal));
+            // vertex texture coords
+            glEnableVertexAttribArray(2);
+            glVertexAttribPointer(2, 2, GL_FLOAT, GL_FALSE, stride, (void*)offsetof(Vertex, TexCoords));
+            // vertex tangent
+            glEnableVertexAttribArray(3);
+            glVertexAttribPointer(3, 3, GL_FLOAT, GL_FALSE, stride, (void*)offsetof(Vertex, Tangent));
+            // vertex bitangent
+            glEnableVertexAttribArray(4);
+            glVertexAttribPointer(4, 3, GL_FLOAT, GL_FALSE, stride, (void*)offsetof(Vertex, Bitangent));
+        }
+        else if (format == VertexFormat::Packed || format == VertexFormat::PackedQuantized)
+        {
+            // vertex Positions, normalized 16-bit when quantized
+            glEnableVertexAttribArray(0);
+            if (format == VertexFormat::Packed)
+                glVertexAttribPointer(0, 3, GL_FLOAT, GL_FALSE, stride, (void*)offsetof(PackedVertex, Position));
+            else
+                glVertexAttribPointer(0, 3, GL_UNSIGNED_SHORT, GL_TRUE, stride, (void*)offsetof(QuantizedVertex, Position));
+            // vertex normals, the shaders read xyz
+            glEnableVertexAttribArray(1);
+            glVertexAttribPointer(1, 4, GL_INT_2_10_10_10_REV, GL_TRUE, stride, (void*)offsetof(PackedVertex, Normal));
+            // vertex texture coords
+            glEnableVertexAttribArray(2);
+            glVertexAttribPointer(2, 2, GL_HALF_FLOAT, GL_FALSE, stride, (void*)offsetof(PackedVertex, TexCoords));
+            // vertex tangent, w holds the bitangent sign: bitangent = cross(normal, tangent.xyz) * tangent.w
+            glEnableVertexAttribArray(3);
+            glVertexAttribPointer(3, 4, GL_INT_2_10_10_10_REV, GL_TRUE, stride, (void*)offsetof(PackedVertex, Tangent));
+        }
+        else
+        {
+            glEnableVertexAttribArray(0);
+            glVertexAttribPointer(0, 3, GL_FLOAT, GL_FALSE, stride, (void*)0);
+            if (format == VertexFormat::PositionTexCoords)
+            {
+                glEnableVertexAttribArray(1);
+                glVertexAttribPointer(1, 2, GL_FLOAT, GL_FALSE, stride, (void*)(3 * sizeof(float)));
+            }
+        }
+    }
+};
+
+class VertexPacking
+{
+public:
+    // signed normalized GL_INT_2_10_10_10_REV, w is -1 or 1
+    static uint32_t PackSnorm1010102(const glm::vec3 &v, float w = 1.0f)
+    {
+        uint32_t x = (uint32_t)snorm(v.x, 511.0f) & 0x3FF;
+        uint32_t y = (uint32_t)snorm(v.y, 511.0f) & 0x3FF;
+        uint32_t z = (uint32_t)snorm(v.z, 511.0f) & 0x3FF;
+        uint32_t sign = (uint32_t)(w < 0.0f ? -1 : 1) & 0x3;
+        return x | y << 10 | z << 20 | sign << 30;
+    }
+
+    // IEEE half float, round to nearest, flushes values too small for a half to zero
+    static uint16_t PackHalf(float value)
+    {
+        uint32_t bits;
+        memcpy(&bits, &value, sizeof(bits));
+        uint32_t sign = (bits >> 16) & 0x8000;
+        int exponent = (int)((bits >> 23) & 0xFF) - 127 + 15;
+        uint32_t mantissa = bits & 0x7FFFFF;
+        if (exponent <= 0)
+            return (uint16_t)sign;
+        if (exponent >= 31)
+            return (uint16_t)(sign | 0x7C00 | (((bits >> 23) & 0xFF) == 0xFF && mantissa ? 0x200 : 0));
+        uint32_t half = sign | (uint32_t)exponent << 10 | mantissa >> 13;
+        if (mantissa & 0x1000)
+            half++; // may carry into the exponent, which rounds up correctly
+        return (uint16_t)half;
+    }
+
+    // sign of the bitangent relative to cross(normal, tangent)
+    static float BitangentSign(const glm::vec3 &normal, const glm::vec3 &tangent, const glm::vec3 &bitangent)
+    {
+        return glm::dot(glm::cross(normal, tangent), bitangent) < 0.0f ? -1.0f : 1.0f;
+    }
+
+private:
+    static int snorm(float value, float scale)
+    {
+        return (int)std::lround(std::max(-1.0f, std::min(1.0f, value)) * scale);
+    }
+};
+#endif
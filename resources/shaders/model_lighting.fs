@@ -3,14 +3,12 @@ out vec4 FragColor;
 
 struct PointLight {
     vec3 position;
-
-    vec3 specular;
-    vec3 diffuse;
-    vec3 ambient;
-
     float constant;
+    vec3 ambient;
     float linear;
+    vec3 diffuse;
     float quadratic;
+    vec3 specular;
 };
 
 struct Material {
@@ -23,11 +21,19 @@ in vec2 TexCoords;
 in vec3 Normal;
 in vec3 FragPos;
 
-uniform PointLight pointLight;
+layout (std140) uniform Camera {
+    mat4 projection;
+    mat4 view;
+    vec3 viewPosition;
+};
+// the scene's point lights, this shader is lit by pointLights[pointLight]
+layout (std140) uniform Lights {
+    PointLight pointLights[4];
+};
+uniform int pointLight;
 uniform Material material;
 uniform bool blinn;
 
-uniform vec3 viewPosition;
 // calculates the color when using a point light.
 vec3 CalcPointLight(PointLight light, vec3 normal, vec3 fragPos, vec3 viewDir)
 {
@@ -68,6 +74,6 @@ void main()
 {
     vec3 normal = normalize(Normal);
     vec3 viewDir = normalize(viewPosition - FragPos);
-    vec3 result = CalcPointLight(pointLight, normal, FragPos, viewDir);
+    vec3 result = CalcPointLight(pointLights[pointLight], normal, FragPos, viewDir);
     FragColor = vec4(result, 1.0);
 }
\ No newline at end of file
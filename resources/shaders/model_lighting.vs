@@ -8,12 +8,18 @@ out vec3 Normal;
 out vec3 FragPos;
 
 uniform mat4 model;
-uniform mat4 view;
-uniform mat4 projection;
+layout (std140) uniform Camera {
+    mat4 projection;
+    mat4 view;
+    vec3 viewPosition;
+};
+// dequantization of the mesh positions, identity unless the mesh was uploaded quantized
+uniform vec3 positionScale;
+uniform vec3 positionOffset;
 
 void main()
 {
-    FragPos = vec3(model * vec4(aPos, 1.0));
+    FragPos = vec3(model * vec4(aPos * positionScale + positionOffset, 1.0));
     Normal = aNormal;
     TexCoords = aTexCoords;    
     gl_Position = projection * view * vec4(FragPos, 1.0);
@@ -14,6 +14,9 @@
 #include <learnopengl/shader.h>
 #include <learnopengl/camera.h>
 #include <learnopengl/model.h>
+#include <learnopengl/asset_loader.h>
+#include <learnopengl/gl_state.h>
+#include <learnopengl/uniform_block.h>
 
 #include <iostream>
 
@@ -60,6 +63,53 @@ struct PointLight {
     float quadratic;
 };
 
+// the uniform blocks the scene shaders share, mirroring their std140 declarations in resources/shaders
+struct CameraBlock {
+    static constexpr const char *Name = "Camera";
+    static constexpr GLuint Binding = 0;
+
+    glm::mat4 projection;
+    glm::mat4 view;
+    glm::vec3 viewPosition;
+    float padding;
+};
+STD140_MEMBER(CameraBlock, projection);
+STD140_MEMBER(CameraBlock, view);
+STD140_MEMBER(CameraBlock, viewPosition);
+
+struct BlockPointLight {
+    glm::vec3 position;
+    float constant;
+    glm::vec3 ambient;
+    float linear;
+    glm::vec3 diffuse;
+    float quadratic;
+    glm::vec3 specular;
+    float padding;
+
+    // `light` placed at `position` with its own ambient and diffuse colors
+    static BlockPointLight From(const PointLight &light, glm::vec3 position, glm::vec3 ambient, glm::vec3 diffuse)
+    {
+        return BlockPointLight{position, light.constant, ambient, light.linear, diffuse, light.quadratic, light.specular, 0.0f};
+    }
+};
+STD140_MEMBER(BlockPointLight, position);
+STD140_MEMBER(BlockPointLight, constant);
+STD140_MEMBER(BlockPointLight, ambient);
+STD140_MEMBER(BlockPointLight, linear);
+STD140_MEMBER(BlockPointLight, diffuse);
+STD140_MEMBER(BlockPointLight, quadratic);
+STD140_MEMBER(BlockPointLight, specular);
+
+// one light per lit model, the shaders pick theirs with their pointLight index
+struct LightsBlock {
+    static constexpr const char *Name = "Lights";
+    static constexpr GLuint Binding = 1;
+
+    BlockPointLight pointLights[4];
+};
+STD140_MEMBER(LightsBlock, pointLights);
+
 struct ProgramState {
     glm::vec3 clearColor = glm::vec3(0);
     bool ImGuiEnabled = false;
@@ -146,6 +196,8 @@ int main() {
         std::cout << "Failed to initialize GLAD" << std::endl;
         return -1;
     }
+    // entry points past 3.3 core, where the driver has them (program binaries for the shader cache)
+    GLExtensions::Load((GLADloadproc) glfwGetProcAddress);
 
     // tell stb_image.h to flip loaded texture's on the y-axis (before loading model).
     //    stbi_set_flip_vertically_on_load(true);
@@ -154,8 +206,8 @@ int main() {
     // -----------------------------
 
     // GLBLEND
-    glEnable(GL_BLEND);
-    glBlendFunc(GL_SRC_ALPHA, GL_ONE_MINUS_SRC_ALPHA);
+    GLState::Enable(GL_BLEND);
+    GLState::BlendFunc(GL_SRC_ALPHA, GL_ONE_MINUS_SRC_ALPHA);
 
     // Change culling
     // glEnable(GL_CULL_FACE);
@@ -179,10 +231,75 @@ int main() {
 
     // configure global opengl state
     // -----------------------------
-    glEnable(GL_DEPTH_TEST);
+    GLState::Enable(GL_DEPTH_TEST);
+
+    // upload textures block-compressed when the driver supports it (baked into .ctex files on first load)
+    TextureLoader::EnableCompression();
+    // textures show up at a low mip right away, the finer levels are uploaded within a 2 ms budget per frame
+    TextureStreamer::Enable(2.0f);
+
+    // load textures and models
+    // -----------------------
+    // decoding and importing run on worker threads while the shaders below compile on this one,
+    // the finished buffers are uploaded in loader.Finish() right before the render loop
+    AssetLoader loader;
+    unsigned int floorTexture = 0, floorMetalTexture = 0, cubeTexture = 0, laserTexture = 0, bombTexture = 0;
+    loader.LoadTexture(FileSystem::getPath("resources/textures/fabric-of-squares.png"), floorTexture);
+    loader.LoadTexture(FileSystem::getPath("resources/textures/metal_tex.jpg"), floorMetalTexture);
+    loader.LoadTexture(FileSystem::getPath("resources/textures/matrix_sredjen.jpg"), cubeTexture);
+    loader.LoadTexture(FileSystem::getPath("resources/textures/green1.jpg"), laserTexture);
+    loader.LoadTexture(FileSystem::getPath("resources/textures/pngwing.com.png"), bombTexture);
+
+    //skybox
+    vector<std::string> faces
+            {
+
+                    FileSystem::getPath("resources/textures/svemir1/skybox_right.png"),
+                    FileSystem::getPath("resources/textures/svemir1/skybox_left.png"),
+                    FileSystem::getPath("resources/textures/svemir1/skybox_up_rotate.png"),
+                    FileSystem::getPath("resources/textures/svemir1/skybox_down_rotate.png"),
+                    FileSystem::getPath("resources/textures/svemir1/skybox_back.png"),
+                    FileSystem::getPath("resources/textures/svemir1/skybox_front.png")
+
+            };
+    unsigned int cubemapTexture = 0;
+    loader.LoadCubemap(faces, cubemapTexture);
+
+    // load models
+    // -----------
+    // the models are uploaded with 16-bit positions and packed normals/tangents/texCoords (20 instead of 56 bytes a vertex),
+    // and split where needed so every mesh draws with 8 or 16-bit indices. nothing reads the geometry back,
+    // so the CPU copies are dropped after upload
+    ModelOptions modelOptions;
+    modelOptions.vertexFormat = VertexFormat::PackedQuantized;
+    modelOptions.splitForShortIndices = true;
+    modelOptions.cpuGeometry = CpuGeometry::Release;
+
+    Model ourModel1(modelOptions);
+    ourModel1.SetShaderTextureNamePrefix("material.");
+    loader.LoadModel(ourModel1, "resources/objects/svemirski/Intergalactic_Spaceship-(Wavefront).obj");
+
+    Model ourModel2(modelOptions);
+    ourModel2.SetShaderTextureNamePrefix("material.");
+    loader.LoadModel(ourModel2, "resources/objects/mars/Mars_2K.obj");
+
+    Model ourModel3(modelOptions);
+    ourModel3.SetShaderTextureNamePrefix("material.");
+    loader.LoadModel(ourModel3, "resources/objects/E-45-Aircraft/E_45_Aircraft_obj.obj");
 
     // build and compile shaders
     // -------------------------
+    // the programs are only submitted here, they compile while the assets finish loading: on the driver's threads
+    // where it has KHR_parallel_shader_compile, otherwise on a worker with a hidden context sharing this one's objects
+    GLFWwindow *compileContext = nullptr;
+    if (!GLExtensions::Get().parallelShaderCompile) {
+        glfwWindowHint(GLFW_VISIBLE, GLFW_FALSE);
+        compileContext = glfwCreateWindow(1, 1, "shader compiler", NULL, window);
+        glfwDefaultWindowHints();
+        if (compileContext)
+            ShaderCompiler::Start([compileContext](bool current) { glfwMakeContextCurrent(current ? compileContext : NULL); });
+    }
+    auto shaderStart = std::chrono::steady_clock::now();
     Shader ourShader("resources/shaders/model_lighting.vs", "resources/shaders/model_lighting.fs");
     Shader marsShader("resources/shaders/model_lighting_mars.vs", "resources/shaders/model_lighting_mars.fs");
     Shader ourskyboxShader("resources/shaders/skybox.vs", "resources/shaders/skybox.fs");
@@ -201,7 +318,7 @@ int main() {
     // create floating point color buffer
     unsigned int colorBuffer;
     glGenTextures(1, &colorBuffer);
-    glBindTexture(GL_TEXTURE_2D, colorBuffer);
+    GLState::BindTexture(0, GL_TEXTURE_2D, colorBuffer);
     glTexImage2D(GL_TEXTURE_2D, 0, GL_RGBA16F, SCR_WIDTH, SCR_HEIGHT, 0, GL_RGBA, GL_FLOAT, NULL);
     glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, GL_LINEAR);
     glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAG_FILTER, GL_LINEAR);
@@ -211,19 +328,14 @@ int main() {
     glBindRenderbuffer(GL_RENDERBUFFER, rboDepth);
     glRenderbufferStorage(GL_RENDERBUFFER, GL_DEPTH_COMPONENT, SCR_WIDTH, SCR_HEIGHT);
     // attach buffers
-    glBindFramebuffer(GL_FRAMEBUFFER, hdrFBO);
+    GLState::BindFramebuffer(hdrFBO);
     glFramebufferTexture2D(GL_FRAMEBUFFER, GL_COLOR_ATTACHMENT0, GL_TEXTURE_2D, colorBuffer, 0);
     glFramebufferRenderbuffer(GL_FRAMEBUFFER, GL_DEPTH_ATTACHMENT, GL_RENDERBUFFER, rboDepth);
     if (glCheckFramebufferStatus(GL_FRAMEBUFFER) != GL_FRAMEBUFFER_COMPLETE)
         std::cout << "Framebuffer not complete!" << std::endl;
-    glBindFramebuffer(GL_FRAMEBUFFER, 0);
+    GLState::BindFramebuffer(0);
 
 
-    // shader configuration
-    // --------------------
-    hdrShader.use();
-    hdrShader.setInt("hdrBuffer", 0);
-
     float cubeVertices[] = {
             // back face
             -0.5f, -0.5f, -0.5f,  0.0f, 0.0f, // bottom-left
@@ -289,18 +401,9 @@ int main() {
 
     };
 
-    // cube VAO
-    unsigned int cubeVAO, cubeVBO;
-    glGenVertexArrays(1, &cubeVAO);
-    glGenBuffers(1, &cubeVBO);
-    glBindVertexArray(cubeVAO);
-    glBindBuffer(GL_ARRAY_BUFFER, cubeVBO);
-    glBufferData(GL_ARRAY_BUFFER, sizeof(cubeVertices), &cubeVertices, GL_STATIC_DRAW);
-    glEnableVertexAttribArray(0);
-    glVertexAttribPointer(0, 3, GL_FLOAT, GL_FALSE, 5 * sizeof(float), (void*)0);
-    glEnableVertexAttribArray(1);
-    glVertexAttribPointer(1, 2, GL_FLOAT, GL_FALSE, 5 * sizeof(float), (void*)(3 * sizeof(float)));
-    glBindVertexArray(0);
+    // cube, plane and transparent geometry share one arena (position + texCoords layout)
+    GeometryArena &sceneGeometry = GeometryArena::For(VertexFormat::PositionTexCoords);
+    GeometryArena::Handle cubeGeometry = sceneGeometry.Allocate(cubeVertices, 36);
 
 
     float planeVertices[] = {
@@ -314,17 +417,8 @@ int main() {
             5.0f, -0.5f, -5.0f,  2.0f, 2.0f
     };
 
-    // plane VAO
-    unsigned int planeVAO, planeVBO;
-    glGenVertexArrays(1, &planeVAO);
-    glGenBuffers(1, &planeVBO);
-    glBindVertexArray(planeVAO);
-    glBindBuffer(GL_ARRAY_BUFFER, planeVBO);
-    glBufferData(GL_ARRAY_BUFFER, sizeof(planeVertices), &planeVertices, GL_STATIC_DRAW);
-    glEnableVertexAttribArray(0);
-    glVertexAttribPointer(0, 3, GL_FLOAT, GL_FALSE, 5 * sizeof(float), (void*)0);
-    glEnableVertexAttribArray(1);
-    glVertexAttribPointer(1, 2, GL_FLOAT, GL_FALSE, 5 * sizeof(float), (void*)(3 * sizeof(float)));
+    // plane geometry
+    GeometryArena::Handle planeGeometry = sceneGeometry.Allocate(planeVertices, 6);
 
     float transparentVertices[] = {
             // positions         // texture Coords (swapped y coordinates because texture is flipped upside down)
@@ -337,26 +431,8 @@ int main() {
             1.0f,  0.5f,  0.0f,  1.0f,  0.0f
     };
 
-    // transparent VAO
-    unsigned int transparentVAO, transparentVBO;
-    glGenVertexArrays(1, &transparentVAO);
-    glGenBuffers(1, &transparentVBO);
-    glBindVertexArray(transparentVAO);
-    glBindBuffer(GL_ARRAY_BUFFER, transparentVBO);
-    glBufferData(GL_ARRAY_BUFFER, sizeof(transparentVertices), transparentVertices, GL_STATIC_DRAW);
-    glEnableVertexAttribArray(0);
-    glVertexAttribPointer(0, 3, GL_FLOAT, GL_FALSE, 5 * sizeof(float), (void*)0);
-    glEnableVertexAttribArray(1);
-    glVertexAttribPointer(1, 2, GL_FLOAT, GL_FALSE, 5 * sizeof(float), (void*)(3 * sizeof(float)));
-    glBindVertexArray(0);
-
-    unsigned int floorTexture = loadTexture(FileSystem::getPath("resources/textures/fabric-of-squares.png").c_str());
-    unsigned int floorMetalTexture = loadTexture(FileSystem::getPath("resources/textures/metal_tex.jpg").c_str());
-    unsigned int cubeTexture  = loadTexture(FileSystem::getPath("resources/textures/matrix_sredjen.jpg").c_str());
-    unsigned int laserTexture  = loadTexture(FileSystem::getPath("resources/textures/green1.jpg").c_str());
-    unsigned int bombTexture  = loadTexture(FileSystem::getPath("resources/textures/pngwing.com.png").c_str());
-
-
+    // transparent geometry
+    GeometryArena::Handle transparentGeometry = sceneGeometry.Allocate(transparentVertices, 6);
 
     float skyboxVertices[] = {
             // positions
@@ -403,44 +479,50 @@ int main() {
             1.0f, -1.0f,  1.0f
     };
 
-    // skybox VAO
-    unsigned int skyboxVAO, skyboxVBO;
-    glGenVertexArrays(1, &skyboxVAO);
-    glGenBuffers(1, &skyboxVBO);
-    glBindVertexArray(skyboxVAO);
-    glBindBuffer(GL_ARRAY_BUFFER, skyboxVBO);
-    glBufferData(GL_ARRAY_BUFFER, sizeof(skyboxVertices), &skyboxVertices, GL_STATIC_DRAW);
-    glEnableVertexAttribArray(0);
-    glVertexAttribPointer(0, 3, GL_FLOAT, GL_FALSE, 3 * sizeof(float), (void*)0);
-
-    //skybox
-    vector<std::string> faces
-            {
-
-                    FileSystem::getPath("resources/textures/svemir1/skybox_right.png"),
-                    FileSystem::getPath("resources/textures/svemir1/skybox_left.png"),
-                    FileSystem::getPath("resources/textures/svemir1/skybox_up_rotate.png"),
-                    FileSystem::getPath("resources/textures/svemir1/skybox_down_rotate.png"),
-                    FileSystem::getPath("resources/textures/svemir1/skybox_back.png"),
-                    FileSystem::getPath("resources/textures/svemir1/skybox_front.png")
+    // skybox geometry, positions only
+    GeometryArena &skyboxArena = GeometryArena::For(VertexFormat::Position);
+    GeometryArena::Handle skyboxGeometry = skyboxArena.Allocate(skyboxVertices, 36);
+
+    // wait for the asset workers and upload everything they decoded, then for the shaders that compiled meanwhile
+    loader.Finish();
+    for (Shader *program: {&ourShader, &marsShader, &ourskyboxShader, &shader, &shaderMetal, &Cubeshader, &hdrShader,
+                           &spaceShip1Shader, &spaceShip2Shader, &bombShader})
+        program->Wait();
+    ShaderCompiler::Stop();
+    if (compileContext)
+        glfwDestroyWindow(compileContext);
+    const ProgramCacheStats &programStats = ProgramCache::Stats();
+    std::cout << "Shaders: " << programStats.hits << " programs from the cache in " << programStats.loadMs << " ms, "
+              << programStats.misses << " compiled in " << programStats.compileMs << " ms ("
+              << programStats.rejected << " cached binaries rejected), all ready "
+              << std::chrono::duration<float, std::milli>(std::chrono::steady_clock::now() - shaderStart).count()
+              << " ms after submitting" << std::endl;
+    const ProgramStats &sharedPrograms = ShaderProgram::Stats();
+    std::cout << "Shaders: " << sharedPrograms.instances << " shaders share " << sharedPrograms.programs << " programs ("
+              << sharedPrograms.programBytes / 1024 << " KB of driver binaries)" << std::endl;
+
+    // camera and lights go to every program through uniform blocks, updated once per frame
+    UniformBlock<CameraBlock> cameraBlock;
+    UniformBlock<LightsBlock> lightsBlock;
+    for (Shader *program: {&ourShader, &marsShader, &ourskyboxShader, &shader, &shaderMetal, &Cubeshader, &hdrShader,
+                           &spaceShip1Shader, &spaceShip2Shader, &bombShader})
+    {
+        UniformBlock<CameraBlock>::Attach(program->ID);
+        UniformBlock<LightsBlock>::Attach(program->ID);
+    }
 
-            };
-    unsigned int cubemapTexture = loadCubemap(faces);
+    // shader configuration
+    // --------------------
+    hdrShader.use();
+    hdrShader.setInt("hdrBuffer", 0);
     ourskyboxShader.use();
     ourskyboxShader.setInt("skybox", 0);
-
-    // load models
-    // -----------
-    Model ourModel1("resources/objects/svemirski/Intergalactic_Spaceship-(Wavefront).obj");
-    ourModel1.SetShaderTextureNamePrefix("material.");
-
-
-    Model ourModel2("resources/objects/mars/Mars_2K.obj");
-    ourModel2.SetShaderTextureNamePrefix("material.");
-
-
-    Model ourModel3("resources/objects/E-45-Aircraft/E_45_Aircraft_obj.obj");
-    ourModel3.SetShaderTextureNamePrefix("material.");
+    Shader *litShaders[] = {&ourShader, &marsShader, &spaceShip1Shader, &spaceShip2Shader};
+    for (int i = 0; i < 4; i++)
+    {
+        litShaders[i]->setInt("pointLight", i);
+        litShaders[i]->setFloat("material.shininess", 32.0f);
+    }
 
     PointLight& pointLight = programState->pointLight;
     pointLight.position = glm::vec3(1.0f, 4.0f, 0.0);
@@ -470,60 +552,30 @@ int main() {
         // -----
         processInput(window);
 
+        // continue streaming texture mips; the streamer binds textures behind GLState's back
+        TextureStreamer::Update();
+        GLState::InvalidateTextures();
+        GLState::Stats().ResetFrame();
+        Model::LodStats().Reset();
+        Mesh::ClusterStats().Reset();
+        ShaderProgram::Stats().ResetFrame();
 
         // render
         // ------
         glClearColor(programState->clearColor.r, programState->clearColor.g, programState->clearColor.b, 1.0f);
         glClear(GL_COLOR_BUFFER_BIT | GL_DEPTH_BUFFER_BIT);
 
-        // don't forget to enable shader before setting uniforms
-        marsShader.use();
-        pointLight.position = glm::vec3(60.0f*sin(currentFrame), 18.0f, -20.0f*cos(currentFrame));
-        marsShader.setVec3("pointLight.position", pointLight.position);
-        marsShader.setVec3("pointLight.ambient", pointLight.ambient);
-        marsShader.setVec3("pointLight.diffuse",glm::vec3(200.6, 200.6, 200.6));
-        marsShader.setVec3("pointLight.specular", pointLight.specular);
-        marsShader.setFloat("pointLight.constant", pointLight.constant);
-        marsShader.setFloat("pointLight.linear", pointLight.linear);
-        marsShader.setFloat("pointLight.quadratic", pointLight.quadratic);
-        marsShader.setVec3("viewPosition", programState->camera.Position);
-        marsShader.setFloat("material.shininess", 32.0f);
-
-        spaceShip1Shader.use();
-        pointLight.position = glm::vec3(50.7f,-10.21f,20.0f);
-        spaceShip1Shader.setVec3("pointLight.position", pointLight.position);
-        spaceShip1Shader.setVec3("pointLight.ambient", glm::vec3(0.15, 0.15, 0.15));
-        spaceShip1Shader.setVec3("pointLight.diffuse",glm::vec3(50.6, 5.6, 1.6));
-        spaceShip1Shader.setVec3("pointLight.specular", pointLight.specular);
-        spaceShip1Shader.setFloat("pointLight.constant", pointLight.constant);
-        spaceShip1Shader.setFloat("pointLight.linear", pointLight.linear);
-        spaceShip1Shader.setFloat("pointLight.quadratic", pointLight.quadratic);
-        spaceShip1Shader.setVec3("viewPosition", programState->camera.Position);
-        spaceShip1Shader.setFloat("material.shininess", 32.0f);
-
-        spaceShip2Shader.use();
-        pointLight.position = glm::vec3(25.77f,-25.9f,-50.9f);
-        spaceShip2Shader.setVec3("pointLight.position", pointLight.position);
-        spaceShip2Shader.setVec3("pointLight.ambient", glm::vec3(0.1, 0.1, 0.1));
-        spaceShip2Shader.setVec3("pointLight.diffuse",glm::vec3(500.6, 5.6, 0.6));
-        spaceShip2Shader.setVec3("pointLight.specular", pointLight.specular);
-        spaceShip2Shader.setFloat("pointLight.constant", pointLight.constant);
-        spaceShip2Shader.setFloat("pointLight.linear", pointLight.linear);
-        spaceShip2Shader.setFloat("pointLight.quadratic", pointLight.quadratic);
-        spaceShip2Shader.setVec3("viewPosition", programState->camera.Position);
-        spaceShip2Shader.setFloat("material.shininess", 32.0f);
-
-        ourShader.use();
+        // the frame's lights, in the order of litShaders
+        LightsBlock lights;
+        lights.pointLights[1] = BlockPointLight::From(pointLight, glm::vec3(60.0f*sin(currentFrame), 18.0f, -20.0f*cos(currentFrame)),
+                                                      pointLight.ambient, glm::vec3(200.6, 200.6, 200.6));
+        lights.pointLights[2] = BlockPointLight::From(pointLight, glm::vec3(50.7f,-10.21f,20.0f),
+                                                      glm::vec3(0.15, 0.15, 0.15), glm::vec3(50.6, 5.6, 1.6));
+        lights.pointLights[3] = BlockPointLight::From(pointLight, glm::vec3(25.77f,-25.9f,-50.9f),
+                                                      glm::vec3(0.1, 0.1, 0.1), glm::vec3(500.6, 5.6, 0.6));
         pointLight.position = glm::vec3(3.0 * cos(currentFrame), 3.0f, 3.0 * sin(currentFrame));
-        ourShader.setVec3("pointLight.position", pointLight.position);
-        ourShader.setVec3("pointLight.ambient", pointLight.ambient);
-        ourShader.setVec3("pointLight.diffuse", pointLight.diffuse);
-        ourShader.setVec3("pointLight.specular", pointLight.specular);
-        ourShader.setFloat("pointLight.constant", pointLight.constant);
-        ourShader.setFloat("pointLight.linear", pointLight.linear);
-        ourShader.setFloat("pointLight.quadratic", pointLight.quadratic);
-        ourShader.setVec3("viewPosition", programState->camera.Position);
-        ourShader.setFloat("material.shininess", 32.0f);
+        lights.pointLights[0] = BlockPointLight::From(pointLight, pointLight.position, pointLight.ambient, pointLight.diffuse);
+        lightsBlock.Update(lights);
         ourShader.setInt("blinn", blinn);
 
 
@@ -531,16 +583,15 @@ int main() {
         glm::mat4 projection = glm::perspective(glm::radians(programState->camera.Zoom),
                                                 (float) SCR_WIDTH / (float) SCR_HEIGHT, 0.1f, 100.0f);
         glm::mat4 view = programState->camera.GetViewMatrix();
-        ourShader.setMat4("projection", projection);
-        ourShader.setMat4("view", view);
+        cameraBlock.Update(CameraBlock{projection, view, programState->camera.Position, 0.0f});
 
         // 1. render scene into floating point framebuffer
         // -----------------------------------------------
-        glBindFramebuffer(GL_FRAMEBUFFER, hdrFBO);
+        GLState::BindFramebuffer(hdrFBO);
         glClear(GL_COLOR_BUFFER_BIT | GL_DEPTH_BUFFER_BIT);
 
-        glEnable(GL_CULL_FACE);
-        glCullFace(GL_FRONT);
+        GLState::Enable(GL_CULL_FACE);
+        GLState::CullFace(GL_FRONT);
         glm::mat4 model = glm::mat4(1.0f);
         model = glm::translate(model,
                                programState->spaceshipPosition); // translate it down so it's at the center of the scene
@@ -562,51 +613,45 @@ int main() {
             model = glm::rotate(model, 1.57f, glm::vec3(0.0,1.0,0.0));
         }
 
+        ourShader.use();
         ourShader.setMat4("model", model);
-        ourModel1.Draw(ourShader);
+        ourModel1.Draw(ourShader, model, view, projection, SCR_HEIGHT, 0);
 
         //spaceShip1
         spaceShip1Shader.use();
-        spaceShip1Shader.setMat4("projection", projection);
-        spaceShip1Shader.setMat4("view", view);
         model = glm::mat4(1.0f);
         model = glm::translate(model,
                                glm::vec3(20.0f,4.0f,8.0f)); // translate it down so it's at the center of the scene
         model = glm::scale(model, glm::vec3(programState->spaceshipScale));    // it's a bit too big for our scene, so scale it down
         model = glm::rotate(model, 1.57f, glm::vec3(0.0f,1.0f,0.33f));
-        ourShader.setMat4("model", model);
-        ourModel1.Draw(ourShader);
+        spaceShip1Shader.setMat4("model", model);
+        ourModel1.Draw(spaceShip1Shader, model, view, projection, SCR_HEIGHT, 1);
 
         //SpaceShip2
         spaceShip2Shader.use();
-        spaceShip2Shader.setMat4("projection", projection);
-        spaceShip2Shader.setMat4("view", view);
         model = glm::mat4(1.0f);
         model = glm::translate(model,
                                glm::vec3(35.0f,7.0f,8.0f)); // translate it down so it's at the center of the scene
         model = glm::scale(model, glm::vec3(programState->spaceshipScale));    // it's a bit too big for our scene, so scale it down
         model = glm::rotate(model, 1.57f, glm::vec3(0.0f,1.0f,0.0f));
-        ourShader.setMat4("model", model);
-        ourModel3.Draw(spaceShip2Shader);
+        spaceShip2Shader.setMat4("model", model);
+        ourModel3.Draw(spaceShip2Shader, model, view, projection, SCR_HEIGHT);
 
         //render the loaded model 2
         marsShader.use();
-        marsShader.setMat4("projection", projection);
-        marsShader.setMat4("view", view);
         model = glm::mat4(1.0f);
         model = glm::translate(model,
                                glm::vec3(30.0f,19.0f,-35.0f)); // translate it down so it's at the center of the scene
         model = glm::scale(model, glm::vec3(2.0f));    // it's a bit too big for our scene, so scale it down
-        ourShader.setMat4("model", model);
-        ourModel2.Draw(marsShader);
-        glDisable(GL_CULL_FACE);
+        marsShader.setMat4("model", model);
+        ourModel2.Draw(marsShader, model, view, projection, SCR_HEIGHT);
+        GLState::Disable(GL_CULL_FACE);
 
 
         // floor
         model = glm::mat4(1.0f);
         shaderMetal.use();
         shaderMetal.setVec3("light.position",  7.0f, -0.6f, 8.5f);
-        shaderMetal.setVec3("viewPos", programState->camera.Position);
 
         // light properties
         shaderMetal.setVec3("light.ambient", 0.1f, 0.1f, 0.1f);
@@ -617,108 +662,84 @@ int main() {
         shaderMetal.setVec3("material.specular", 0.5f, 0.5f, 0.5f);
         shaderMetal.setFloat("material.shininess", 32.0f);
 
-        glBindVertexArray(planeVAO);
-        glBindTexture(GL_TEXTURE_2D, floorMetalTexture);
-        shader.setMat4("projection", projection);
-        shader.setMat4("view", view);
+        GLState::BindTexture(0, GL_TEXTURE_2D, floorMetalTexture);
         model = glm::mat4(1.0f);
         model = glm::translate(model,
                                glm::vec3(0.0f,-0.70f,0.0f)); // translate it down so it's at the center of the scene
         model = glm::scale(model, glm::vec3(2.0f));
-        shader.setMat4("model", model);
-        glDrawArrays(GL_TRIANGLES, 0, 6);
+        shaderMetal.setMat4("model", model);
+        sceneGeometry.Draw(planeGeometry);
 
         //bomba
         model = glm::mat4(1.0f);
         bombShader.use();
-        glBindVertexArray(transparentVAO);
-        glBindTexture(GL_TEXTURE_2D, bombTexture);
-        bombShader.setMat4("projection", projection);
-        bombShader.setMat4("view", view);
+        GLState::BindTexture(0, GL_TEXTURE_2D, bombTexture);
         model = glm::mat4(1.0f);
         model = glm::translate(model,
                                glm::vec3(32.2f,6.5f,8.0f)); // translate it down so it's at the center of the scene
         model = glm::scale(model, glm::vec3(3.0f,3.0f,6.0f));
         model = glm::rotate(model, 1.57f, glm::vec3(0.0f,0.0f,1.0f));
         bombShader.setMat4("model", model);
-        glDrawArrays(GL_TRIANGLES, 0, 6);
+        sceneGeometry.Draw(transparentGeometry);
 
         for(int i = 0; i < 4; i++) {
             //kocke
-            glEnable(GL_CULL_FACE);
-            glCullFace(GL_BACK);
+            GLState::Enable(GL_CULL_FACE);
+            GLState::CullFace(GL_BACK);
             model = glm::mat4(1.0f);
             Cubeshader.use();
-            Cubeshader.setMat4("view", view);
-            Cubeshader.setMat4("projection", projection);
-            glBindVertexArray(cubeVAO);
-            glActiveTexture(GL_TEXTURE0);
-            glBindTexture(GL_TEXTURE_2D, cubeTexture);
+            GLState::BindTexture(0, GL_TEXTURE_2D, cubeTexture);
             model = glm::translate(model, cubePositions[i]);
             model = glm::scale(model, glm::vec3(2.0f, 2.0f, 2.0f));
             Cubeshader.setMat4("model", model);
-            glDrawArrays(GL_TRIANGLES, 0, 36);
-            glDisable(GL_CULL_FACE);
+            sceneGeometry.Draw(cubeGeometry);
+            GLState::Disable(GL_CULL_FACE);
         }
 
         //laseri
         for(int i = 0; i < 4; i++) {
-            glEnable(GL_CULL_FACE);
-            glCullFace(GL_BACK);
+            GLState::Enable(GL_CULL_FACE);
+            GLState::CullFace(GL_BACK);
             model = glm::mat4(1.0f);
             Cubeshader.use();
-            Cubeshader.setMat4("view", view);
-            Cubeshader.setMat4("projection", projection);
-            glBindVertexArray(cubeVAO);
-            glActiveTexture(GL_TEXTURE0);
-            glBindTexture(GL_TEXTURE_2D, laserTexture);
+            GLState::BindTexture(0, GL_TEXTURE_2D, laserTexture);
             model = glm::translate(model, LaserPositions[i]);
             model = glm::rotate(model, 1.57f / 4, glm::vec3(0.0f, 0.0f, 1.0f));
             model = glm::scale(model, glm::vec3(2.0f, 0.18f, 0.18f));
-            shader.setMat4("model", model);
-            glDrawArrays(GL_TRIANGLES, 0, 36);
-            glDisable(GL_CULL_FACE);
+            Cubeshader.setMat4("model", model);
+            sceneGeometry.Draw(cubeGeometry);
+            GLState::Disable(GL_CULL_FACE);
         }
 
         //transparent wall
         for(int i = 0; i < 2; i++) {
             model = glm::mat4(1.0f);
             shader.use();
-            glBindVertexArray(planeVAO);
-            glBindTexture(GL_TEXTURE_2D, floorTexture);
-            shader.setMat4("projection", projection);
-            shader.setMat4("view", view);
+            GLState::BindTexture(0, GL_TEXTURE_2D, floorTexture);
             model = glm::mat4(1.0f);
             model = glm::translate(model,
                                    transparentPositions[i]); // translate it down so it's at the center of the scene
             model = glm::scale(model, glm::vec3(1.0f, 2.0f, 1.0f));
             model = glm::rotate(model, 1.57f, glm::vec3(0.0f, 0.0f, 1.0f));
             shader.setMat4("model", model);
-            glDrawArrays(GL_TRIANGLES, 0, 6);
+            sceneGeometry.Draw(planeGeometry);
         }
 
         // draw skybox as last
-        glDepthFunc(GL_LEQUAL);  // change depth function so depth test passes when values are equal to depth buffer's content
+        GLState::DepthFunc(GL_LEQUAL);  // change depth function so depth test passes when values are equal to depth buffer's content
         ourskyboxShader.use();
-        view = glm::mat4(glm::mat3(programState->camera.GetViewMatrix())); // remove translation from the view matrix
-        ourskyboxShader.setMat4("view", view);
-        ourskyboxShader.setMat4("projection", projection);
         // skybox cube
-        glBindVertexArray(skyboxVAO);
-        glActiveTexture(GL_TEXTURE0);
-        glBindTexture(GL_TEXTURE_CUBE_MAP, cubemapTexture);
-        glDrawArrays(GL_TRIANGLES, 0, 36);
-        glBindVertexArray(0);
-        glDepthFunc(GL_LESS); // set depth function back to default
+        GLState::BindTexture(0, GL_TEXTURE_CUBE_MAP, cubemapTexture);
+        skyboxArena.Draw(skyboxGeometry);
+        GLState::DepthFunc(GL_LESS); // set depth function back to default
 
-        glBindFramebuffer(GL_FRAMEBUFFER, 0);
+        GLState::BindFramebuffer(0);
 
         // 2. now render floating point color buffer to 2D quad and tonemap HDR colors to default framebuffer's (clamped) color range
         // --------------------------------------------------------------------------------------------------------------------------
         glClear(GL_COLOR_BUFFER_BIT | GL_DEPTH_BUFFER_BIT);
         hdrShader.use();
-        glActiveTexture(GL_TEXTURE0);
-        glBindTexture(GL_TEXTURE_2D, colorBuffer);
+        GLState::BindTexture(0, GL_TEXTURE_2D, colorBuffer);
         hdrShader.setInt("hdr", hdr);
         hdrShader.setFloat("exposure", exposure);
         renderQuad();
@@ -735,8 +756,11 @@ int main() {
         glfwPollEvents();
     }
 
-    glDeleteVertexArrays(1, &skyboxVAO);
-    glDeleteBuffers(1, &skyboxVBO);
+    GeometryArena::DestroyAll();
+    PixelUploadRing::Destroy();
+    cameraBlock.Release();
+    lightsBlock.Release();
+    ProgramRegistry::DeleteAll();
 
     programState->SaveToFile("resources/program_state.txt");
     delete programState;
@@ -866,8 +890,81 @@ void DrawImGui(ProgramState *programState) {
         ImGui::End();
     }
 
+    {
+        TextureStreamingStats streaming = TextureStreamer::Stats();
+        ImGui::Begin("Texture streaming");
+        ImGui::Text("%zu textures pending, %zu KB to go", streaming.pending, streaming.bytesPending / 1024);
+        ImGui::Text("last frame: %zu KB in %.2f ms", streaming.bytesLastFrame / 1024, streaming.msLastFrame);
+        ImGui::Text("%zu at full resolution, time to full: last %.0f ms, max %.0f ms", streaming.completed,
+                    streaming.lastTimeToFullMs, streaming.maxTimeToFullMs);
+        PixelUploadStats uploads = PixelUploadRing::Get().Stats();
+        ImGui::Text("upload ring: %zu KB in flight, %zu uploads, %zu KB staged, %zu KB bypassed", uploads.bytesInFlight / 1024,
+                    uploads.uploads, uploads.bytesStaged / 1024, uploads.bytesBypassed / 1024);
+        ImGui::Text("upload ring waits: %zu, %.2f ms total", uploads.waits, uploads.waitMs);
+        ImGui::End();
+    }
+
+    {
+        MeshLodSettings &settings = Model::LodSettings();
+        const MeshLodStats &stats = Model::LodStats();
+        ImGui::Begin("Mesh LOD");
+        ImGui::SliderFloat("Error threshold (px)", &settings.pixelThreshold, 0.25f, 16.0f);
+        ImGui::SliderFloat("Hysteresis", &settings.hysteresis, 0.0f, 0.9f);
+        ImGui::SliderInt("Forced LOD", &settings.forcedLod, -1, MAX_MESH_LODS - 1);
+        ImGui::Text("triangles: %zu of %zu (%.0f%% saved)", stats.trianglesDrawn, stats.trianglesFull,
+                    stats.trianglesFull ? 100.0f * (1.0f - (float)stats.trianglesDrawn / stats.trianglesFull) : 0.0f);
+        for (int lod = 0; lod < MAX_MESH_LODS; lod++)
+            ImGui::Text("meshes at LOD %d: %zu", lod, stats.meshesAtLod[lod]);
+        ImGui::End();
+    }
+
+    {
+        const MeshClusterStats &stats = Mesh::ClusterStats();
+        ImGui::Begin("Cluster culling");
+        ImGui::Checkbox("Enabled", &Mesh::ClusterCulling());
+        ImGui::Text("clusters: %zu of %zu accepted", stats.accepted, stats.tested);
+        ImGui::Text("triangles: %zu of %zu submitted (%.0f%% culled)", stats.trianglesAccepted, stats.trianglesTested,
+                    stats.trianglesTested ? 100.0f * (1.0f - (float)stats.trianglesAccepted / stats.trianglesTested) : 0.0f);
+        ImGui::End();
+    }
+
+    {
+        static const char *formatNames[] = {"Full", "Packed", "PackedQuantized", "PositionTexCoords", "Position"};
+        ImGui::Begin("Geometry arenas");
+        for (int i = 0; i < (int)VertexFormat::Count; i++)
+        {
+            GeometryArena *arena = GeometryArena::Find((VertexFormat)i);
+            if (!arena)
+                continue;
+            GeometryArenaStats stats = arena->Stats();
+            ImGui::Text("%s: %zu ranges, %zu growths, %zu compactions", formatNames[i], stats.allocations, stats.growths, stats.compactions);
+            ImGui::Text("  vertices %zu/%zu KB, %zu free blocks, fragmentation %.2f", stats.vertices.used / 1024,
+                        stats.vertices.capacity / 1024, stats.vertices.freeBlocks, stats.vertices.fragmentation);
+            ImGui::Text("  indices  %zu/%zu KB, %zu free blocks, fragmentation %.2f", stats.indices.used / 1024,
+                        stats.indices.capacity / 1024, stats.indices.freeBlocks, stats.indices.fragmentation);
+        }
+        ImGui::End();
+
+        ImGui::Begin("Shader programs");
+        const ProgramStats &programs = ShaderProgram::Stats();
+        ImGui::Text("%u shaders, %u programs", programs.instances, programs.programs);
+        ImGui::Text("binds: %zu, skipped %zu", programs.binds, programs.bindsSkipped);
+        ImGui::Text("uniform uploads: %zu, skipped %zu, unknown names %zu", programs.uniformUploads, programs.uniformsSkipped,
+                    programs.unknownUniforms);
+        ImGui::End();
+
+        ImGui::Begin("GL state");
+        const GLStateStats &state = GLState::Stats();
+        for (int i = 0; i < GLStateStats::Count; i++)
+            ImGui::Text("%-16s %4zu calls, %4zu redundant skipped", GLStateStats::Name((GLStateStats::Kind)i), state.calls[i],
+                        state.skipped[i]);
+        ImGui::End();
+    }
+
     ImGui::Render();
     ImGui_ImplOpenGL3_RenderDrawData(ImGui::GetDrawData());
+    // the backend restores what it changed, but with plain GL calls
+    GLState::Invalidate();
 }
 
 void key_callback(GLFWwindow *window, int key, int scancode, int action, int mods) {
@@ -885,79 +982,21 @@ void key_callback(GLFWwindow *window, int key, int scancode, int action, int mod
 
 unsigned int loadCubemap(vector<std::string> faces)
 {
-    unsigned int textureID;
-    glGenTextures(1, &textureID);
-    glBindTexture(GL_TEXTURE_CUBE_MAP, textureID);
-
-    int width, height, nrChannels;
-    for (unsigned int i = 0; i < faces.size(); i++)
-    {
-        unsigned char *data = stbi_load(faces[i].c_str(), &width, &height, &nrChannels, 0);
-        if (data)
-        {
-            glTexImage2D(GL_TEXTURE_CUBE_MAP_POSITIVE_X + i, 0, GL_RGB, width, height, 0, GL_RGB, GL_UNSIGNED_BYTE, data);
-            stbi_image_free(data);
-        }
-        else
-        {
-            std::cout << "Cubemap texture failed to load at path: " << faces[i] << std::endl;
-            stbi_image_free(data);
-        }
-    }
-    glTexParameteri(GL_TEXTURE_CUBE_MAP, GL_TEXTURE_MIN_FILTER, GL_LINEAR);
-    glTexParameteri(GL_TEXTURE_CUBE_MAP, GL_TEXTURE_MAG_FILTER, GL_LINEAR);
-    glTexParameteri(GL_TEXTURE_CUBE_MAP, GL_TEXTURE_WRAP_S, GL_CLAMP_TO_EDGE);
-    glTexParameteri(GL_TEXTURE_CUBE_MAP, GL_TEXTURE_WRAP_T, GL_CLAMP_TO_EDGE);
-    glTexParameteri(GL_TEXTURE_CUBE_MAP, GL_TEXTURE_WRAP_R, GL_CLAMP_TO_EDGE);
-
-    return textureID;
+    return TextureRegistry::LoadCubemap(faces);
 }
 
 unsigned int loadTexture(char const * path)
 {
-    unsigned int textureID;
-    glGenTextures(1, &textureID);
-
-    int width, height, nrComponents;
-    unsigned char *data = stbi_load(path, &width, &height, &nrComponents, 0);
-    if (data)
-    {
-        GLenum format;
-        if (nrComponents == 1)
-            format = GL_RED;
-        else if (nrComponents == 3)
-            format = GL_RGB;
-        else if (nrComponents == 4)
-            format = GL_RGBA;
-
-        glBindTexture(GL_TEXTURE_2D, textureID);
-        glTexImage2D(GL_TEXTURE_2D, 0, format, width, height, 0, format, GL_UNSIGNED_BYTE, data);
-        glGenerateMipmap(GL_TEXTURE_2D);
-
-        glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_S, GL_REPEAT);
-        glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_T, GL_REPEAT);
-        glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, GL_LINEAR_MIPMAP_LINEAR);
-        glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAG_FILTER, GL_LINEAR);
-
-        stbi_image_free(data);
-    }
-    else
-    {
-        std::cout << "Texture failed to load at path: " << path << std::endl;
-        stbi_image_free(data);
-    }
-
-    return textureID;
-
+    return TextureRegistry::Load2D(path);
 }
 
 // renderQuad() renders a 1x1 XY quad in NDC
 // -----------------------------------------
-unsigned int quadVAO = 0;
-unsigned int quadVBO;
+GeometryArena::Handle quadGeometry = GeometryArena::INVALID_HANDLE;
 void renderQuad()
 {
-    if (quadVAO == 0)
+    GeometryArena &arena = GeometryArena::For(VertexFormat::PositionTexCoords);
+    if (quadGeometry == GeometryArena::INVALID_HANDLE)
     {
         float quadVertices[] = {
                 // positions        // texture Coords
@@ -966,18 +1005,8 @@ void renderQuad()
                 1.0f,  1.0f, 0.0f, 1.0f, 1.0f,
                 1.0f, -1.0f, 0.0f, 1.0f, 0.0f,
         };
-        // setup plane VAO
-        glGenVertexArrays(1, &quadVAO);
-        glGenBuffers(1, &quadVBO);
-        glBindVertexArray(quadVAO);
-        glBindBuffer(GL_ARRAY_BUFFER, quadVBO);
-        glBufferData(GL_ARRAY_BUFFER, sizeof(quadVertices), &quadVertices, GL_STATIC_DRAW);
-        glEnableVertexAttribArray(0);
-        glVertexAttribPointer(0, 3, GL_FLOAT, GL_FALSE, 5 * sizeof(float), (void*)0);
-        glEnableVertexAttribArray(1);
-        glVertexAttribPointer(1, 2, GL_FLOAT, GL_FALSE, 5 * sizeof(float), (void*)(3 * sizeof(float)));
+        // setup quad geometry
+        quadGeometry = arena.Allocate(quadVertices, 4);
     }
-    glBindVertexArray(quadVAO);
-    glDrawArrays(GL_TRIANGLE_STRIP, 0, 4);
-    glBindVertexArray(0);
+    arena.Draw(quadGeometry, GL_TRIANGLE_STRIP);
 }
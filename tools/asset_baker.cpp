@@ -0,0 +1,122 @@
+#include <glad/glad.h>
+
+#include <learnopengl/model.h>
+#include <learnopengl/parallel.h>
+#include <learnopengl/texture_loader.h>
+
+#include <dirent.h>
+#include <sys/stat.h>
+
+#include <atomic>
+#include <chrono>
+#include <iostream>
+#include <sstream>
+#include <string>
+#include <vector>
+
+// Offline baker for the runtime caches: walks a resource directory and writes, next to every source,
+// the .meshcache of each OBJ model (welded, cache optimized, clustered, with its LOD chain) and the .ctex of
+// each image (block compressed mip chain). Both caches are keyed on the content hash of their source, so
+// a run only redoes inputs that changed since the last bake. Assets are baked in parallel.
+//
+// usage: asset_baker [resource directory, default "resources"]
+
+struct BakeJob {
+    enum Kind { Mesh, Texture } kind;
+    std::string path;
+};
+
+static bool hasExtension(const std::string &path, const char *extension)
+{
+    size_t dot = path.find_last_of('.');
+    if (dot == std::string::npos)
+        return false;
+    std::string suffix = path.substr(dot + 1);
+    for (char &c: suffix)
+        c = tolower(c);
+    return suffix == extension;
+}
+
+static void collect(const std::string &directory, std::vector<BakeJob> &jobs)
+{
+    DIR *dir = opendir(directory.c_str());
+    if (!dir)
+        return;
+    while (dirent *entry = readdir(dir))
+    {
+        std::string name = entry->d_name;
+        if (name == "." || name == "..")
+            continue;
+        std::string path = directory + "/" + name;
+        struct stat info;
+        if (stat(path.c_str(), &info) != 0)
+            continue;
+        if (S_ISDIR(info.st_mode))
+            collect(path, jobs);
+        else if (hasExtension(path, "obj"))
+            jobs.push_back({BakeJob::Mesh, path});
+        else if (hasExtension(path, "jpg") || hasExtension(path, "jpeg") || hasExtension(path, "png") ||
+                 hasExtension(path, "tga") || hasExtension(path, "bmp"))
+            jobs.push_back({BakeJob::Texture, path});
+    }
+    closedir(dir);
+}
+
+static bool textureCurrent(const std::string &path)
+{
+    CompressedTexture texture;
+    int width, height, components;
+    uint64_t key = TextureCache::Key(path);
+    return key != 0 && TextureCache::Load(TextureCache::PathFor(path), key, texture, width, height, components);
+}
+
+// returns false if the source could not be read; `baked` tells whether a cache file was (re)written
+static bool bake(const BakeJob &job, bool &baked)
+{
+    if (job.kind == BakeJob::Mesh)
+    {
+        baked = !MeshCache::IsCurrent(MeshCache::PathFor(job.path), MeshCache::Key(job.path, importFlags));
+        if (!baked)
+            return true;
+        ModelData data;
+        return Model::Import(job.path, data);
+    }
+    baked = !textureCurrent(job.path);
+    if (!baked)
+        return true;
+    TextureImage image = TextureLoader::Decode(job.path);
+    bool decoded = image.width > 0 && !image.compressed.levels.empty();
+    TextureLoader::Free(image);
+    return decoded;
+}
+
+int main(int argc, char **argv)
+{
+    std::string root = argc > 1 ? argv[1] : "resources";
+    std::vector<BakeJob> jobs;
+    collect(root, jobs);
+    if (jobs.empty())
+    {
+        std::cout << "asset_baker: nothing to bake under " << root << std::endl;
+        return 1;
+    }
+
+    // the runtime only reads .ctex files when the driver has S3TC, which is what they are encoded for
+    TextureLoader::EnableOfflineCompression();
+
+    auto start = std::chrono::steady_clock::now();
+    std::atomic<int> bakedCount(0), currentCount(0), failedCount(0);
+    ParallelFor(jobs.size(), [&](size_t i) {
+        bool baked = false;
+        bool ok = bake(jobs[i], baked);
+        (ok ? (baked ? bakedCount : currentCount) : failedCount)++;
+        std::ostringstream line;
+        line << (ok ? (baked ? "baked      " : "up to date ") : "FAILED     ") << jobs[i].path << "\n";
+        std::cout << line.str();
+    });
+    double seconds = std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+
+    std::cout << "asset_baker: " << bakedCount << " baked, " << currentCount << " up to date, " << failedCount
+              << " failed in " << seconds << " s" << std::endl;
+    return failedCount > 0 ? 1 : 0;
+}
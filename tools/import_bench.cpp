@@ -0,0 +1,268 @@
+#include <glad/glad.h>
+#include <GLFW/glfw3.h>
+
+#include <learnopengl/model.h>
+
+#include <dirent.h>
+#include <sys/stat.h>
+
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <cstdio>
+#include <cstdlib>
+#include <fstream>
+#include <iostream>
+#include <new>
+#include <sstream>
+#include <string>
+#include <vector>
+
+// Import throughput of every model format in a directory (by default the E-45 aircraft, which ships the same
+// model in a dozen formats), each run split into parse (ObjLoader, GlbLoader or ASSIMP), post-process
+// (Model::PostProcess: weld, optimize, clusters, LODs) and GPU upload (Model::Upload of the geometry, textures
+// left out, timed up to glFinish). Per phase it reports the mean wall time, the peak RSS and the number of
+// heap allocations, plus the vertex and index counts each phase hands on. The mesh cache is never used.
+//
+// usage: import_bench [directory, default resources/objects/E-45-Aircraft] [runs, default 5]
+
+// every operator new of the process goes through here, ASSIMP's included. malloc (stb_image) is not counted.
+static std::atomic<size_t> allocationCount(0);
+
+void *operator new(size_t size)
+{
+    allocationCount++;
+    if (void *p = malloc(size ? size : 1))
+        return p;
+    throw std::bad_alloc();
+}
+
+void operator delete(void *p) noexcept
+{
+    free(p);
+}
+
+void operator delete(void *p, size_t) noexcept
+{
+    free(p);
+}
+
+struct PhaseStats {
+    double ms = 0.0;          // summed over the runs
+    size_t peakRssKb = 0;     // highest over the runs
+    size_t allocations = 0;   // summed over the runs
+    size_t vertices = 0, indices = 0;
+};
+
+struct BenchCase {
+    std::string label;
+    std::string path;
+    bool native = true;
+    PhaseStats parse, postProcess, upload;
+    int failures = 0;
+};
+
+// resets the kernel's peak RSS of the process, so VmHWM measures one phase. needs Linux 4.0+,
+// otherwise the figures are the peak since start.
+static void resetPeakRss()
+{
+    std::ofstream("/proc/self/clear_refs") << "5";
+}
+
+static size_t peakRssKb()
+{
+    std::ifstream status("/proc/self/status");
+    std::string line;
+    while (std::getline(status, line))
+        if (line.compare(0, 6, "VmHWM:") == 0)
+            return strtoul(line.c_str() + 6, nullptr, 10);
+    return 0;
+}
+
+class PhaseTimer
+{
+public:
+    explicit PhaseTimer(PhaseStats &stats) : stats(stats), allocations(allocationCount.load()),
+                                             start(std::chrono::steady_clock::now())
+    {
+        resetPeakRss();
+    }
+
+    void Stop()
+    {
+        stats.ms += std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - start).count();
+        stats.allocations += allocationCount.load() - allocations;
+        stats.peakRssKb = std::max(stats.peakRssKb, peakRssKb());
+    }
+
+private:
+    PhaseStats &stats;
+    size_t allocations;
+    std::chrono::steady_clock::time_point start;
+};
+
+static std::string extensionOf(const std::string &path)
+{
+    std::string extension = path.substr(path.find_last_of('.') + 1);
+    std::transform(extension.begin(), extension.end(), extension.begin(), ::tolower);
+    return extension;
+}
+
+static void count(const std::vector<MeshData> &meshes, PhaseStats &stats)
+{
+    stats.vertices = stats.indices = 0;
+    for (const MeshData &mesh: meshes)
+    {
+        stats.vertices += mesh.vertices.size();
+        stats.indices += mesh.indices.size();
+    }
+}
+
+static void run(BenchCase &bench, bool gl, const ModelOptions &options)
+{
+    ModelData data;
+    data.path = bench.path;
+    data.directory = bench.path.substr(0, bench.path.find_last_of('/'));
+
+    PhaseTimer parse(bench.parse);
+    bool ok;
+    if (extensionOf(bench.path) == "glb")
+    {
+        data.glb = std::make_shared<GlbAsset>();
+        ok = GlbLoader::Load(bench.path, *data.glb);
+    }
+    else
+        ok = Model::Parse(bench.path, data.meshes, bench.native);
+    parse.Stop();
+    if (!ok)
+    {
+        bench.failures++;
+        return;
+    }
+    count(data.meshes, bench.parse);
+
+    // .glb geometry goes to the GPU as stored, there is nothing to post-process
+    if (!data.glb)
+    {
+        PhaseTimer postProcess(bench.postProcess);
+        Model::PostProcess(bench.path, data.meshes);
+        postProcess.Stop();
+        count(data.meshes, bench.postProcess);
+    }
+
+    if (!gl)
+        return;
+    // geometry only: textures would measure image decoding, which is the same for every format
+    for (MeshData &mesh: data.meshes)
+        mesh.textures.clear();
+    if (data.glb)
+        for (GlbPrimitive &primitive: data.glb->primitives)
+            primitive.textures.clear();
+    bench.upload.vertices = bench.postProcess.vertices;
+    bench.upload.indices = bench.postProcess.indices;
+
+    // Upload reports every model on cout, which would drown the table
+    std::ostringstream discard;
+    std::streambuf *out = std::cout.rdbuf(discard.rdbuf());
+    Model model(options);
+    PhaseTimer upload(bench.upload);
+    model.Upload(data);
+    glFinish();
+    upload.Stop();
+    model.Release();
+    std::cout.rdbuf(out);
+}
+
+static void printPhase(const char *name, const PhaseStats &stats, int runs)
+{
+    printf("    %-13s %10.2f ms %10.1f MB %12zu allocs %10zu vertices %10zu indices\n", name, stats.ms / runs,
+           stats.peakRssKb / 1024.0, stats.allocations / runs, stats.vertices, stats.indices);
+}
+
+int main(int argc, char **argv)
+{
+    std::string directory = argc > 1 ? argv[1] : "resources/objects/E-45-Aircraft";
+    int runs = argc > 2 ? std::max(1, atoi(argv[2])) : 5;
+
+    std::vector<BenchCase> cases;
+    if (DIR *dir = opendir(directory.c_str()))
+    {
+        static const char *skipped[] = {"mtl", "jpg", "jpeg", "png", "tga", "bmp", "meshcache", "ctex", "txt"};
+        while (dirent *entry = readdir(dir))
+        {
+            std::string name = entry->d_name;
+            std::string path = directory + "/" + name;
+            std::string extension = extensionOf(name);
+            struct stat info;
+            if (name[0] == '.' || name.find('.') == std::string::npos || stat(path.c_str(), &info) != 0 || S_ISDIR(info.st_mode) ||
+                std::find(std::begin(skipped), std::end(skipped), extension) != std::end(skipped))
+                continue;
+            cases.push_back(BenchCase());
+            cases.back().label = extension;
+            cases.back().path = path;
+            // OBJ also through ASSIMP, to compare against the native reader
+            if (extension == "obj")
+            {
+                cases.push_back(cases.back());
+                cases.back().label = "obj (assimp)";
+                cases.back().native = false;
+            }
+        }
+        closedir(dir);
+    }
+    if (cases.empty())
+    {
+        std::cout << "import_bench: no models in " << directory << std::endl;
+        return 1;
+    }
+    std::stable_sort(cases.begin(), cases.end(), [](const BenchCase &a, const BenchCase &b) { return a.path < b.path; });
+
+    // a hidden window for the upload phase; without a display the benchmark still runs the CPU phases
+    bool gl = false;
+    GLFWwindow *window = nullptr;
+    if (glfwInit())
+    {
+        glfwWindowHint(GLFW_CONTEXT_VERSION_MAJOR, 3);
+        glfwWindowHint(GLFW_CONTEXT_VERSION_MINOR, 3);
+        glfwWindowHint(GLFW_OPENGL_PROFILE, GLFW_OPENGL_CORE_PROFILE);
+        glfwWindowHint(GLFW_VISIBLE, GLFW_FALSE);
+        window = glfwCreateWindow(64, 64, "import_bench", nullptr, nullptr);
+        if (window)
+        {
+            glfwMakeContextCurrent(window);
+            gl = gladLoadGLLoader((GLADloadproc) glfwGetProcAddress);
+        }
+    }
+    if (!gl)
+        std::cout << "import_bench: no GL context, skipping the upload phase" << std::endl;
+
+    // the options main.cpp loads its models with
+    ModelOptions options;
+    options.vertexFormat = VertexFormat::PackedQuantized;
+    options.splitForShortIndices = true;
+    options.cpuGeometry = CpuGeometry::Release;
+
+    std::cout << "import_bench: " << cases.size() << " loaders, " << runs << " runs each, mean per run" << std::endl;
+    for (BenchCase &bench: cases)
+    {
+        for (int i = 0; i < runs; i++)
+            run(bench, gl, options);
+        printf("%-14s %s\n", bench.label.c_str(), bench.path.substr(bench.path.find_last_of('/') + 1).c_str());
+        if (bench.failures == runs)
+        {
+            printf("    failed to import\n");
+            continue;
+        }
+        int succeeded = runs - bench.failures;
+        printPhase("parse", bench.parse, succeeded);
+        printPhase("post-process", bench.postProcess, succeeded);
+        if (gl)
+            printPhase("upload", bench.upload, succeeded);
+        printf("    %-13s %10.2f ms\n", "total", (bench.parse.ms + bench.postProcess.ms + bench.upload.ms) / succeeded);
+    }
+
+    if (window)
+        glfwDestroyWindow(window);
+    glfwTerminate();
+    return 0;
+}